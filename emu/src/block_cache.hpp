@@ -0,0 +1,82 @@
+#pragma once
+#include "bus.hpp"
+#include "decode.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace cosmo {
+
+// Basic-block decode cache for CPU::run
+//
+// Guest code is translated once into runs of DecodedInst that end at the
+// first branch, jump, SYSTEM or AMO instruction (see ends_block()). Blocks
+// are keyed by start PC at halfword granularity, so the fast loop does one
+// table lookup per block instead of fetch + expand + decode per instruction.
+//
+// Only flash is cached: the bus treats it as read-only, so cached blocks can
+// never go stale. Code running from SRAM/FSMC is decoded per instruction.
+
+class BlockCache {
+public:
+    static constexpr uint32_t MAX_BLOCK_LEN = 64;
+
+    // Drop all blocks and set the cacheable range [0, code_end)
+    void reset(uint32_t code_end) {
+        code_end_ = code_end;
+        index_.assign(code_end / 2, Entry{});
+        insts_.clear();
+    }
+
+    // Decode Zba/Zbb/Zbs (drops all blocks)
+    void set_bitmanip(bool on) {
+        bitmanip_ = on;
+        reset(code_end_);
+    }
+
+    // Get the block starting at pc, decoding it on first use.
+    // Returns nullptr if pc is outside the cached region.
+    const DecodedInst* lookup(uint32_t pc, uint32_t& count, Bus& bus) {
+        if (pc + 4 > code_end_) return nullptr;
+
+        Entry& e = index_[pc >> 1];
+        if (__builtin_expect(e.count == 0, 0)) {
+            e = decode_block(pc, bus);
+        }
+        count = e.count;
+        return insts_.data() + e.first;
+    }
+
+private:
+    struct Entry {
+        uint32_t first = 0;  // Index of first instruction in insts_
+        uint32_t count = 0;  // 0 = not decoded yet
+    };
+
+    uint32_t code_end_ = 0;
+    bool bitmanip_ = false;
+    std::vector<Entry> index_;
+    std::vector<DecodedInst> insts_;
+
+    Entry decode_block(uint32_t pc, Bus& bus) {
+        Entry e{static_cast<uint32_t>(insts_.size()), 0};
+
+        while (e.count < MAX_BLOCK_LEN && pc + 4 <= code_end_) {
+            uint32_t inst = bus.read32(pc);
+            uint32_t len = 4;
+            if (is_compressed(inst)) {
+                inst = expand_compressed(inst & 0xFFFF);
+                len = 2;
+            }
+
+            DecodedInst di = predecode(inst, len, bitmanip_);
+            insts_.push_back(di);
+            e.count++;
+            pc += len;
+
+            if (ends_block(di.op)) break;
+        }
+        return e;
+    }
+};
+
+} // namespace cosmo
@@ -1,6 +1,9 @@
 #pragma once
+#include "fastmem.hpp"
+#include <array>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <optional>
@@ -20,92 +23,311 @@ struct Device {
     virtual std::optional<Interrupt> tick(uint64_t cycles) { return {}; }
 };
 
-struct DeviceMapping {
-    uint32_t base;
-    uint32_t size;
-    Device* device;
-};
-
 class Bus {
-    std::vector<DeviceMapping> mappings_;
+public:
+    static constexpr uint32_t PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_BITS;  // 4 KB
+    static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+private:
+    // Two-level page table over the 32-bit address space: 1024 directory
+    // entries of 4 MB, each pointing to a table of 1024 pages. Pages of
+    // RAM-like regions carry host pointers and are accessed without any
+    // virtual call; all other pages name the device that handles them.
+    // Unused directory entries share one table of unmapped pages, so a
+    // lookup is always two loads and never a branch.
+    //
+    // Devices smaller than a page are fine, but two devices must not share
+    // a page.
+    static constexpr uint32_t DIR_BITS = 10;
+    static constexpr uint32_t TABLE_BITS = 32 - DIR_BITS - PAGE_BITS;
+    static constexpr uint32_t TABLE_SIZE = 1u << TABLE_BITS;
+
+    struct Page {
+        uint8_t* read_mem = nullptr;   // Host memory backing the page (direct reads)
+        uint8_t* write_mem = nullptr;  // Same for direct writes, nullptr if read-only
+        Device* device = nullptr;      // Device mapped here (MMIO if no read_mem)
+        uint32_t base = 0;             // Device base address
+        uint32_t size = 0;             // Device size
+        bool watched = false;          // Write-tracked (see watch_writes)
+    };
 
-    // Fast-path with direct data pointers (no virtual calls)
+    std::array<Page*, 1u << DIR_BITS> dir_;
+    std::unique_ptr<Page[]> unmapped_;
+    std::vector<std::unique_ptr<Page[]>> tables_;
+
+    // Fast-path regions (also used by the block cache and the JIT)
     uint8_t* flash_data_ = nullptr;
     uint32_t flash_end_ = 0;
     uint8_t* sram_data_ = nullptr;
     uint32_t sram_base_ = 0, sram_end_ = 0;
 
+    std::function<void(uint32_t)> write_hook_;
+
+    // Optional fastmem arena (see fastmem.hpp)
+    Fastmem* fastmem_ = nullptr;
+    uint8_t* fastmem_base_ = nullptr;
+
+    uint64_t device_accesses_ = 0;
+
+    static constexpr uint32_t width_bytes(Width w) { return 1u << static_cast<uint32_t>(w); }
+
+    // Misaligned access that spans two pages (always taken slowly)
+    static bool crosses_page(uint32_t addr, Width w) {
+        return (addr & PAGE_MASK) > PAGE_SIZE - width_bytes(w);
+    }
+
+    const Page& page(uint32_t addr) const {
+        return dir_[addr >> (32 - DIR_BITS)][(addr >> PAGE_BITS) & (TABLE_SIZE - 1)];
+    }
+
+    // Writable page entry, splitting off a private table if needed
+    Page& page_for_update(uint32_t addr) {
+        Page*& table = dir_[addr >> (32 - DIR_BITS)];
+        if (table == unmapped_.get()) {
+            tables_.push_back(std::make_unique<Page[]>(TABLE_SIZE));
+            table = tables_.back().get();
+        }
+        return table[(addr >> PAGE_BITS) & (TABLE_SIZE - 1)];
+    }
+
+    // First write to a clean tracked page: report it and make it writable
+    void touch_watched(uint32_t page_addr) {
+        Page& p = page_for_update(page_addr);
+        p.write_mem = p.read_mem;
+        if (fastmem_) fastmem_->protect(page_addr, PAGE_SIZE, Fastmem::Access::ReadWrite);
+        write_hook_(page_addr);
+    }
+
+    // Call fn(page) for every page overlapping [base, base + size)
+    template <typename F>
+    void for_each_page(uint32_t base, uint32_t size, F&& fn) {
+        uint64_t end = static_cast<uint64_t>(base) + size;
+        for (uint64_t a = base & ~PAGE_MASK; a < end; a += PAGE_SIZE) {
+            fn(static_cast<uint32_t>(a), page_for_update(static_cast<uint32_t>(a)));
+        }
+    }
+
 public:
+    Bus() : unmapped_(std::make_unique<Page[]>(TABLE_SIZE)) {
+        dir_.fill(unmapped_.get());
+    }
+
+    Bus(const Bus&) = delete;
+    Bus& operator=(const Bus&) = delete;
+
     void map(uint32_t base, uint32_t size, Device* dev) {
-        mappings_.push_back({base, size, dev});
+        for_each_page(base, size, [&](uint32_t, Page& p) {
+            p = Page{nullptr, nullptr, dev, base, size, false};
+        });
+    }
+
+    // Back an already mapped, page-aligned region with host memory, so
+    // accesses bypass the device. Read-only regions still send writes to
+    // the device.
+    void map_memory(uint32_t base, uint32_t size, uint8_t* data, bool writable) {
+        for_each_page(base, size, [&](uint32_t a, Page& p) {
+            p.read_mem = data + (a - base);
+            p.write_mem = writable ? p.read_mem : nullptr;
+        });
+    }
+
+    // Dirty tracking for a writable memory region: the first write to each
+    // page since the last rearm_watch() calls hook(page address) and makes
+    // the page directly writable again, so tracking costs nothing on the
+    // fast path. Writes that bypass the Bus are not seen.
+    void watch_writes(uint32_t base, uint32_t size, std::function<void(uint32_t)> hook) {
+        write_hook_ = std::move(hook);
+        for_each_page(base, size, [&](uint32_t, Page& p) { p.watched = true; });
+        rearm_watch(base, size);
+    }
+
+    // Start a new tracking period for [base, base + size)
+    void rearm_watch(uint32_t base, uint32_t size) {
+        for_each_page(base, size, [&](uint32_t a, Page& p) {
+            if (!p.watched || !p.write_mem) return;
+            p.write_mem = nullptr;
+            if (fastmem_) fastmem_->protect(a, PAGE_SIZE, Fastmem::Access::Read);
+        });
+    }
+
+    // Switch read()/write() to a fastmem arena: map every memory-backed page
+    // (which must come from HostMemory) into it. Call after all regions are
+    // mapped and watched. Returns false if the arena could not be set up.
+    bool set_fastmem(Fastmem* fm) {
+        if (!fm->base()) return false;
+        for (uint32_t d = 0; d < dir_.size(); d++) {
+            if (dir_[d] == unmapped_.get()) continue;
+            for (uint32_t t = 0; t < TABLE_SIZE; t++) {
+                const Page& p = dir_[d][t];
+                if (!p.read_mem) continue;
+                uint32_t a = (d << (32 - DIR_BITS)) | (t << PAGE_BITS);
+                auto access = p.write_mem ? Fastmem::Access::ReadWrite : Fastmem::Access::Read;
+                if (!fm->alias(a, p.read_mem, PAGE_SIZE, access)) return false;
+            }
+        }
+        fastmem_ = fm;
+        fastmem_base_ = fm->base();
+        return true;
+    }
+
+    // Host memory behind [addr, addr + len) if the whole range is memory
+    // backed and contiguous on the host, else nullptr. With `write` the
+    // range must be writable, and tracked pages count as written. Used for
+    // block transfers (DMA).
+    uint8_t* memory_span(uint32_t addr, uint32_t len, bool write) {
+        if (len == 0 || static_cast<uint64_t>(addr) + len > (1ULL << 32)) return nullptr;
+        uint32_t first = addr & ~PAGE_MASK;
+        uint32_t last = (addr + len - 1) & ~PAGE_MASK;
+        uint8_t* host = page(first).read_mem;
+        if (!host) return nullptr;
+
+        for (uint64_t a = first; a <= last; a += PAGE_SIZE) {
+            const Page& p = page(static_cast<uint32_t>(a));
+            if (p.read_mem != host + (a - first)) return nullptr;
+            if (write && !p.write_mem && !p.watched) return nullptr;
+        }
+        if (write) {
+            for (uint64_t a = first; a <= last; a += PAGE_SIZE) {
+                if (!page(static_cast<uint32_t>(a)).write_mem) touch_watched(static_cast<uint32_t>(a));
+            }
+        }
+        return host + (addr - first);
     }
 
     void set_fast_path(uint8_t* flash, uint32_t fs,
                        uint8_t* sram, uint32_t sb, uint32_t ss) {
         flash_data_ = flash; flash_end_ = fs;
         sram_data_ = sram; sram_base_ = sb; sram_end_ = sb + ss;
+        map_memory(0, fs, flash, false);
+        map_memory(sb, ss, sram, true);
     }
 
+    // End of the read-only flash region (code that never changes at runtime)
+    uint32_t flash_end() const { return flash_end_; }
+
+    // Direct-access SRAM window (inlined by the JIT)
+    uint8_t* sram_data() const { return sram_data_; }
+    uint32_t sram_base() const { return sram_base_; }
+    uint32_t sram_size() const { return sram_end_ - sram_base_; }
+
     Device* find(uint32_t addr) const {
-        for (auto& m : mappings_) {
-            if (addr >= m.base && addr < m.base + m.size)
-                return m.device;
-        }
-        return nullptr;
+        const Page& p = page(addr);
+        return (p.device && addr - p.base < p.size) ? p.device : nullptr;
     }
 
+    // Accesses handled by a device so far (MMIO, from the CPU or DMA)
+    uint64_t device_accesses() const { return device_accesses_; }
+
     uint32_t offset(uint32_t addr) const {
-        for (auto& m : mappings_) {
-            if (addr >= m.base && addr < m.base + m.size)
-                return addr - m.base;
-        }
-        return addr;
+        const Page& p = page(addr);
+        return (p.device && addr - p.base < p.size) ? addr - p.base : addr;
     }
 
     uint32_t read(uint32_t addr, Width w) {
-        // Fast-path for flash (inline, no virtual call)
-        if (addr < flash_end_) {
+        uint32_t val;
+        if (__builtin_expect(!try_read(addr, w, val), 0)) {
+            val = read_slow(addr, w);
+        }
+        return val;
+    }
+
+    // Inline part of read(): false if the access needs read_slow()
+    bool try_read(uint32_t addr, Width w, uint32_t& val) {
+#ifdef COSMO_FASTMEM
+        if (fastmem_base_) {
+            const uint8_t* m = fastmem_base_ + addr;
             switch (w) {
-                case Width::Byte: return flash_data_[addr];
-                case Width::Half: return *reinterpret_cast<uint16_t*>(flash_data_ + addr);
-                case Width::Word: return *reinterpret_cast<uint32_t*>(flash_data_ + addr);
+                case Width::Byte: return fastmem::load8(m, val);
+                case Width::Half: return fastmem::load16(m, val);
+                case Width::Word: return fastmem::load32(m, val);
             }
         }
-        // Fast-path for sram (inline, no virtual call)
-        if (addr >= sram_base_ && addr < sram_end_) {
-            uint8_t* p = sram_data_ + (addr - sram_base_);
+#endif
+        const Page& p = page(addr);
+        // Fast-path for memory (inline, no virtual call). The fastmem arena
+        // is contiguous, so only the page table has to split page crossings.
+        if (__builtin_expect(p.read_mem != nullptr && !crosses_page(addr, w), 1)) {
+            const uint8_t* m = p.read_mem + (addr & PAGE_MASK);
             switch (w) {
-                case Width::Byte: return *p;
-                case Width::Half: return *reinterpret_cast<uint16_t*>(p);
-                case Width::Word: return *reinterpret_cast<uint32_t*>(p);
+                case Width::Byte: val = *m; return true;
+                case Width::Half: val = *reinterpret_cast<const uint16_t*>(m); return true;
+                case Width::Word: val = *reinterpret_cast<const uint32_t*>(m); return true;
             }
         }
-        // Slow path for peripherals
-        for (auto& m : mappings_) {
-            if (addr >= m.base && addr < m.base + m.size)
-                return m.device->read(addr - m.base, w);
-        }
-        std::fprintf(stderr, "[BUS] Unmapped read: 0x%08X\n", addr);
-        return 0;
+        return false;
     }
 
     void write(uint32_t addr, Width w, uint32_t val) {
-        // Fast-path for sram (inline, no virtual call)
-        if (addr >= sram_base_ && addr < sram_end_) {
-            uint8_t* p = sram_data_ + (addr - sram_base_);
+        if (__builtin_expect(!try_write(addr, w, val), 0)) {
+            write_slow(addr, w, val);
+        }
+    }
+
+    // Inline part of write(): false if the access needs write_slow()
+    bool try_write(uint32_t addr, Width w, uint32_t val) {
+#ifdef COSMO_FASTMEM
+        if (fastmem_base_) {
+            uint8_t* m = fastmem_base_ + addr;
             switch (w) {
-                case Width::Byte: *p = val; return;
-                case Width::Half: *reinterpret_cast<uint16_t*>(p) = val; return;
-                case Width::Word: *reinterpret_cast<uint32_t*>(p) = val; return;
+                case Width::Byte: return fastmem::store8(m, val);
+                case Width::Half: return fastmem::store16(m, val);
+                case Width::Word: return fastmem::store32(m, val);
             }
         }
-        // Slow path for peripherals
-        for (auto& m : mappings_) {
-            if (addr >= m.base && addr < m.base + m.size) {
-                m.device->write(addr - m.base, w, val);
-                return;
+#endif
+        const Page& p = page(addr);
+        // Fast-path for writable memory (inline, no virtual call)
+        if (__builtin_expect(p.write_mem != nullptr && !crosses_page(addr, w), 1)) {
+            uint8_t* m = p.write_mem + (addr & PAGE_MASK);
+            switch (w) {
+                case Width::Byte: *m = val; return true;
+                case Width::Half: *reinterpret_cast<uint16_t*>(m) = val; return true;
+                case Width::Word: *reinterpret_cast<uint32_t*>(m) = val; return true;
             }
         }
+        return false;
+    }
+
+    // Peripherals, tracked pages, unmapped addresses and accesses spanning
+    // two pages, which are split into bytes (kept out of line
+    // so read()/write() stay small enough to inline into the CPU loop).
+    // Also where faulting fastmem accesses end up.
+    __attribute__((noinline)) uint32_t read_slow(uint32_t addr, Width w) {
+        if (crosses_page(addr, w)) {
+            uint32_t val = 0;
+            for (uint32_t i = 0; i < width_bytes(w); i++) {
+                val |= read(addr + i, Width::Byte) << (8 * i);
+            }
+            return val;
+        }
+        const Page& p = page(addr);
+        if (p.device && addr - p.base < p.size) {
+            device_accesses_++;
+            return p.device->read(addr - p.base, w);
+        }
+        std::fprintf(stderr, "[BUS] Unmapped read: 0x%08X\n", addr);
+        return 0;
+    }
+
+    __attribute__((noinline)) void write_slow(uint32_t addr, Width w, uint32_t val) {
+        if (crosses_page(addr, w)) {
+            for (uint32_t i = 0; i < width_bytes(w); i++) {
+                write(addr + i, Width::Byte, (val >> (8 * i)) & 0xFF);
+            }
+            return;
+        }
+        const Page& p = page(addr);
+        if (p.watched) {
+            touch_watched(addr & ~PAGE_MASK);
+            write(addr, w, val);
+            return;
+        }
+        if (p.device && addr - p.base < p.size) {
+            device_accesses_++;
+            p.device->write(addr - p.base, w, val);
+            return;
+        }
         std::fprintf(stderr, "[BUS] Unmapped write: 0x%08X = 0x%08X\n", addr, val);
     }
 
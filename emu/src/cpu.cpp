@@ -1,14 +1,63 @@
 #include "cpu.hpp"
 #include "decode.hpp"
 #include "device/pfic.hpp"
+#include "fpu.hpp"
+#include "jit.hpp"
+#include "scheduler.hpp"
 #include <algorithm>
 #include <cstdio>
 
 
 namespace cosmo {
 
+// Zba/Zbb/Zbs semantics, shared by step() and run() (b is rs2 or the
+// immediate). Inlined with a constant op into every run() handler.
+__attribute__((always_inline)) static inline uint32_t bitmanip_op(Uop op, uint32_t a, uint32_t b) {
+    uint32_t bit = 1u << (b & 0x1F);
+    switch (op) {
+        case Uop::SH1ADD: return (a << 1) + b;
+        case Uop::SH2ADD: return (a << 2) + b;
+        case Uop::SH3ADD: return (a << 3) + b;
+        case Uop::ANDN:   return a & ~b;
+        case Uop::ORN:    return a | ~b;
+        case Uop::XNOR:   return ~(a ^ b);
+        case Uop::MIN:    return (int32_t)a < (int32_t)b ? a : b;
+        case Uop::MINU:   return a < b ? a : b;
+        case Uop::MAX:    return (int32_t)a > (int32_t)b ? a : b;
+        case Uop::MAXU:   return a > b ? a : b;
+        case Uop::ROL:    return (a << (b & 0x1F)) | (a >> (-b & 0x1F));
+        case Uop::ROR:
+        case Uop::RORI:   return (a >> (b & 0x1F)) | (a << (-b & 0x1F));
+        case Uop::CLZ:    return a ? __builtin_clz(a) : 32;
+        case Uop::CTZ:    return a ? __builtin_ctz(a) : 32;
+        case Uop::CPOP:   return __builtin_popcount(a);
+        case Uop::SEXTB:  return (uint32_t)(int8_t)a;
+        case Uop::SEXTH:  return (uint32_t)(int16_t)a;
+        case Uop::ZEXTH:  return a & 0xFFFF;
+        case Uop::ORCB: {
+            uint32_t r = 0;
+            for (int i = 0; i < 32; i += 8) {
+                if ((a >> i) & 0xFF) r |= 0xFFu << i;
+            }
+            return r;
+        }
+        case Uop::REV8:   return __builtin_bswap32(a);
+        case Uop::BCLR:
+        case Uop::BCLRI:  return a & ~bit;
+        case Uop::BEXT:
+        case Uop::BEXTI:  return (a >> (b & 0x1F)) & 1;
+        case Uop::BINV:
+        case Uop::BINVI:  return a ^ bit;
+        case Uop::BSET:
+        case Uop::BSETI:  return a | bit;
+        default:          return 0;
+    }
+}
+
 void CPU::reset(uint32_t start_pc) {
     x.fill(0);
+    f.fill(0);
+    fcsr = 0;
     pc = start_pc;
     cycles = 0;
     mstatus = 0;
@@ -18,13 +67,41 @@ void CPU::reset(uint32_t start_pc) {
     mcause = 0;
     mtval = 0;
     mip = 0;
+    stalled_ = cycle_offset_ = instret_offset_ = 0;
+    hpm_ = {};
+    hpm_events_ = {};
+    hpm_insts_ = false;
+    intsyscr = 0;
+    hpe_top_ = trap_depth_ = 0;
+    irq_top_ = 0;
     reservation_valid = false;
     halted = false;
     wfi = false;
+    block_cache_.reset(bus->flash_end());
+    if (jit) jit->reset(bus->flash_end());
+}
+
+void CPU::set_pfic(PFIC* p) {
+    pfic = p;
+    if (pfic) pfic->set_doorbell(&irq_doorbell);
+}
+
+void CPU::set_jit(Jit* j) {
+    jit = j;
+    if (jit) jit->reset(bus->flash_end());
+}
+
+void CPU::set_bitmanip(bool on) {
+    bitmanip_ = on;
+    block_cache_.set_bitmanip(on);
+    if (jit) jit->reset(bus->flash_end());
 }
 
 uint32_t CPU::csr_read(uint32_t addr) {
     switch (static_cast<CSR>(addr)) {
+        case CSR::fflags:  sync_fflags(); return fcsr & 0x1F;
+        case CSR::frm:     return fcsr >> 5;
+        case CSR::fcsr:    sync_fflags(); return fcsr;
         case CSR::mstatus: return mstatus;
         case CSR::mie:     return mie;
         case CSR::mtvec:   return mtvec;
@@ -32,28 +109,162 @@ uint32_t CPU::csr_read(uint32_t addr) {
         case CSR::mcause:  return mcause;
         case CSR::mtval:   return mtval;
         case CSR::mip:     return mip;
-        default:
-            std::fprintf(stderr, "[CPU] Unknown CSR read: 0x%03X at PC=0x%08X\n", addr, pc);
-            return 0;
+        case CSR::mcountinhibit: return 0;  // Counters always run
+        case CSR::intsyscr: return intsyscr;
+        default: break;
     }
+
+    // Counters are numbered by their low 5 bits: mcycle (0), time (1),
+    // minstret (2), mhpmcounter3..31. 0xB80/0xC80 hold the high halves,
+    // 0xCxx the read-only user-mode shadows of 0xBxx.
+    uint32_t group = addr & 0xF60;
+    if (group == static_cast<uint32_t>(CSR::mcycle) || group == static_cast<uint32_t>(CSR::cycle)) {
+        uint64_t v = counter_read(addr & 0x1F);
+        return (addr & 0x80) ? static_cast<uint32_t>(v >> 32) : static_cast<uint32_t>(v);
+    }
+    uint32_t event = addr - static_cast<uint32_t>(CSR::mhpmevent3);
+    if (event < 29) {
+        return event < HPM_COUNTERS ? static_cast<uint32_t>(hpm_[event].event) : 0;
+    }
+
+    std::fprintf(stderr, "[CPU] Unknown CSR read: 0x%03X at PC=0x%08X\n", addr, pc);
+    return 0;
 }
 
 void CPU::csr_write(uint32_t addr, uint32_t val) {
     switch (static_cast<CSR>(addr)) {
-        case CSR::mstatus: mstatus = val & 0x88; break; // MIE(3), MPIE(7)
-        case CSR::mie:     mie = val; break;
+        case CSR::fflags:  sync_fflags(); fcsr = (fcsr & ~0x1Fu) | (val & 0x1F); break;
+        case CSR::frm:     fcsr = (fcsr & 0x1F) | (val & 0x7) << 5; break;
+        case CSR::fcsr:    sync_fflags(); fcsr = val & 0xFF; break;
+        case CSR::mstatus: mstatus = val & (0x88 | MSTATUS_FS); irq_doorbell = true; break; // MIE(3), MPIE(7)
+        case CSR::mie:     mie = val; irq_doorbell = true; break;
         case CSR::mtvec:   mtvec = val & ~0x2; break; // Mode 0 or 1 only
         case CSR::mepc:    mepc = val & ~0x1; break;  // Aligned
         case CSR::mcause:  mcause = val; break;
         case CSR::mtval:   mtval = val; break;
-        case CSR::mip:     mip = val; break;
-        default:
+        case CSR::mip:     mip = val; irq_doorbell = true; break;
+        case CSR::mcountinhibit: break;
+        case CSR::intsyscr: intsyscr = val & (INTSYSCR_HWSTKEN | INTSYSCR_INESTEN); break;
+        default: {
+            uint32_t group = addr & 0xF60;
+            if (group == static_cast<uint32_t>(CSR::mcycle)) {
+                uint32_t index = addr & 0x1F;
+                uint64_t v = counter_read(index);
+                if (addr & 0x80) {
+                    v = (v & 0xFFFFFFFFull) | static_cast<uint64_t>(val) << 32;
+                } else {
+                    v = (v & ~0xFFFFFFFFull) | val;
+                }
+                counter_write(index, v);
+                break;
+            }
+            if (group == static_cast<uint32_t>(CSR::cycle)) break;  // Read-only
+            uint32_t event = addr - static_cast<uint32_t>(CSR::mhpmevent3);
+            if (event < 29) {
+                hpm_select(event, val);
+                break;
+            }
             std::fprintf(stderr, "[CPU] Unknown CSR write: 0x%03X = 0x%08X at PC=0x%08X\n", addr, val, pc);
             break;
+        }
+    }
+}
+
+uint64_t CPU::event_total(HpmEvent e) const {
+    if (e == HpmEvent::Mmio) return bus->device_accesses();
+    return hpm_events_[static_cast<size_t>(e)];
+}
+
+uint64_t CPU::counter_read(uint32_t index) const {
+    switch (index) {
+        case 0: return cycles + cycle_offset_;
+        case 1: return cycles;  // time: the timebase is the core clock
+        case 2: return cycles - stalled_ + instret_offset_;
+        default:
+            if (index - 3 < HPM_COUNTERS) {
+                const HpmCounter& c = hpm_[index - 3];
+                return event_total(c.event) - c.base;
+            }
+            return 0;  // mhpmcounter7..31 are hardwired to zero
     }
 }
 
+void CPU::counter_write(uint32_t index, uint64_t val) {
+    switch (index) {
+        case 0: cycle_offset_ = val - cycles; break;
+        case 2: instret_offset_ = val - (cycles - stalled_); break;
+        default:
+            if (index - 3 < HPM_COUNTERS) {
+                HpmCounter& c = hpm_[index - 3];
+                c.base = event_total(c.event) - val;
+            }
+            break;
+    }
+}
+
+void CPU::hpm_select(uint32_t index, uint32_t event) {
+    if (index >= HPM_COUNTERS) return;
+    uint64_t val = counter_read(index + 3);  // Keeps counting from here
+    HpmCounter& c = hpm_[index];
+    c.event = event < static_cast<uint32_t>(HpmEvent::Count) ? static_cast<HpmEvent>(event) : HpmEvent::None;
+    c.base = event_total(c.event) - val;
+
+    hpm_insts_ = false;
+    for (const HpmCounter& h : hpm_) {
+        if (h.event == HpmEvent::Load || h.event == HpmEvent::Store || h.event == HpmEvent::TakenBranch) {
+            hpm_insts_ = true;
+        }
+    }
+}
+
+// Tally the first n instructions of a block that started at block_pc and
+// continued at next_pc. Only the last one can be a taken branch.
+void CPU::count_block(const DecodedInst* di, uint64_t n, uint32_t block_pc, uint32_t next_pc) {
+    uint64_t loads = 0, stores = 0;
+    uint32_t fallthrough = block_pc;
+    for (uint64_t i = 0; i < n; i++) {
+        loads += (di[i].op >= Uop::LB && di[i].op <= Uop::LHU) || di[i].op == Uop::FLW;
+        stores += (di[i].op >= Uop::SB && di[i].op <= Uop::SW) || di[i].op == Uop::FSW;
+        fallthrough += di[i].len;
+    }
+    hpm_count(HpmEvent::Load, loads);
+    hpm_count(HpmEvent::Store, stores);
+    if (n && di[n - 1].op >= Uop::BEQ && di[n - 1].op <= Uop::BGEU && next_pc != fallthrough) {
+        hpm_count(HpmEvent::TakenBranch);
+    }
+}
+
+void CPU::sync_fflags() {
+    fcsr |= fpu::take_host_flags();
+}
+
+void CPU::idle(uint64_t until) {
+    if (until > cycles) {
+        stalled_ += until - cycles;
+        cycles = until;
+    }
+}
+
+// Registers saved by HPE, in stack order
+static constexpr uint8_t hpe_regs[CPU::HPE_REGS] = {
+    1, 5, 6, 7, 10, 11, 12, 13, 14, 15, 16, 17, 28, 29, 30, 31,
+};
+
+void CPU::hpe_push() {
+    if (!(intsyscr & INTSYSCR_HWSTKEN) || hpe_top_ == HPE_DEPTH) return;
+    HpeFrame& f = hpe_[hpe_top_++];
+    for (uint32_t i = 0; i < HPE_REGS; i++) f.regs[i] = x[hpe_regs[i]];
+    f.depth = trap_depth_;
+}
+
+void CPU::hpe_pop() {
+    if (!hpe_top_ || hpe_[hpe_top_ - 1].depth != trap_depth_) return;
+    const HpeFrame& f = hpe_[--hpe_top_];
+    for (uint32_t i = 0; i < HPE_REGS; i++) x[hpe_regs[i]] = f.regs[i];
+}
+
 void CPU::take_trap(TrapCause cause, uint32_t tval) {
+    trap_depth_++;
     mepc = pc;
     mcause = static_cast<uint32_t>(cause);
     mtval = tval;
@@ -72,7 +283,7 @@ void CPU::take_trap(TrapCause cause, uint32_t tval) {
     }
 }
 
-void CPU::take_interrupt(InterruptCause cause) {
+void CPU::take_interrupt(InterruptCause cause, uint32_t vtf) {
     // If PC points to a WFI instruction, skip it.
     // WFI should return immediately when an interrupt is pending,
     // so we skip it and set mepc to the instruction AFTER WFI.
@@ -88,6 +299,15 @@ void CPU::take_interrupt(InterruptCause cause) {
         pc += inst_len;  // Skip WFI
     }
 
+    hpm_count(HpmEvent::Interrupt);
+
+    // Entry takes a cycle and retires nothing
+    cycles++;
+    stalled_++;
+
+    trap_depth_++;
+    hpe_push();
+
     mepc = pc;
     // Interrupt bit (bit 31) + cause
     mcause = 0x80000000 | static_cast<uint32_t>(cause);
@@ -98,7 +318,10 @@ void CPU::take_interrupt(InterruptCause cause) {
     mstatus = (mstatus & ~0x88) | (mie_bit << 7);
 
     // Jump to trap vector
-    if ((mtvec & 0x1) == 0) {
+    if (vtf) {
+        // PFIC VTF - bypasses mtvec
+        pc = vtf;
+    } else if ((mtvec & 0x1) == 0) {
         // Direct mode - all interrupts go to same address
         pc = mtvec & ~0x3;
     } else {
@@ -112,6 +335,32 @@ void CPU::mret() {
     uint32_t mpie = (mstatus >> 7) & 1;
     mstatus = (mstatus & ~0x88) | (mpie << 3) | 0x80;
     pc = mepc;
+
+    hpe_pop();
+    if (irq_top_ && irq_levels_[irq_top_ - 1].depth == trap_depth_) {
+        const IrqLevel& l = irq_levels_[--irq_top_];
+        if (pfic) pfic->clear_active(l.irq);
+        if (irq_top_) {
+            // Back in the preempted handler
+            mepc = l.mepc;
+            mcause = l.mcause;
+            mstatus = (mstatus & ~0x80) | l.mpie;
+        }
+    }
+    if (trap_depth_) trap_depth_--;
+}
+
+bool CPU::preempts(uint32_t irq) const {
+    if (!irq_top_) return true;
+    return (intsyscr & INTSYSCR_INESTEN) && irq_top_ < NEST_DEPTH &&
+           pfic->priority(irq) < pfic->priority(irq_levels_[irq_top_ - 1].irq);
+}
+
+void CPU::enter_irq(uint32_t irq) {
+    irq_levels_[irq_top_++] = {irq, trap_depth_ + 1, mepc, mcause, mstatus & 0x80};
+    pfic->set_active(irq);
+    take_interrupt(InterruptCause::MExternal, pfic->vtf_address(irq));
+    if (intsyscr & INTSYSCR_INESTEN) mstatus |= 0x8;  // Preemptible until it clears MIE
 }
 
 bool CPU::check_interrupts() {
@@ -130,9 +379,7 @@ bool CPU::check_interrupts() {
     }
 
     // Check if interrupts are globally enabled
-    if (!interrupts_enabled()) {
-        return false;
-    }
+    if (!interrupts_enabled()) return false;
 
     // Check for pending and enabled interrupts (priority: external > timer > software)
     // Machine external interrupt
@@ -140,9 +387,8 @@ bool CPU::check_interrupts() {
         // Check PFIC for actual pending interrupt
         if (pfic) {
             int irq = pfic->get_pending_irq();
-            if (irq >= 0) {
-                pfic->set_active(irq);
-                take_interrupt(InterruptCause::MExternal);
+            if (irq >= 0 && preempts(irq)) {
+                enter_irq(irq);
                 return true;
             }
         } else {
@@ -206,8 +452,8 @@ void CPU::step() {
 
     // Execute based on opcode
     switch (static_cast<OpType>(op)) {
-        case OpType::OP:       exec_op(inst); break;
-        case OpType::OP_IMM:   exec_op_imm(inst); break;
+        case OpType::OP:       if (!exec_op(inst)) return; break;
+        case OpType::OP_IMM:   if (!exec_op_imm(inst)) return; break;
         case OpType::LOAD:     exec_load(inst); break;
         case OpType::STORE:    exec_store(inst); break;
         case OpType::BRANCH:   exec_branch(inst); return; // PC set by branch
@@ -215,9 +461,26 @@ void CPU::step() {
         case OpType::JALR:     exec_jalr(inst); return;
         case OpType::LUI:      exec_lui(inst); break;
         case OpType::AUIPC:    exec_auipc(inst); break;
-        case OpType::SYSTEM:   exec_system(inst); if (op == 0x73 && funct3(inst) == 0) return; break;
+        case OpType::SYSTEM:
+            fpu::take_host_flags();  // Drop flags raised by host code (fflags reads)
+            exec_system(inst);
+            if (op == 0x73 && funct3(inst) == 0) return;
+            break;
         case OpType::AMO:      exec_amo(inst); break;
         case OpType::MISC_MEM: exec_misc_mem(inst); break;
+        case OpType::LOAD_FP:
+        case OpType::STORE_FP:
+        case OpType::MADD:
+        case OpType::MSUB:
+        case OpType::NMSUB:
+        case OpType::NMADD:
+        case OpType::OP_FP: {
+            fpu::take_host_flags();  // Drop flags raised by host code
+            bool ok = exec_fp(inst);
+            sync_fflags();
+            if (!ok) return;
+            break;
+        }
         default:
             illegal_instruction(inst);
             return;
@@ -228,254 +491,397 @@ void CPU::step() {
 
     // Check for pending interrupts AFTER instruction completes
     // This ensures mepc points to the NEXT instruction (not the current one)
-    if (check_interrupts()) {
-        cycles++;
-    }
+    check_interrupts();
 }
 
 void CPU::run(uint64_t target_cycles) {
     // Check interrupts first (syncs mip with PFIC, wakes from WFI if needed)
+    irq_doorbell = false;
     check_interrupts();
     if (halted || wfi) return;
 
+    fpu::take_host_flags();  // Drop flags raised by host code
+
     // Cache frequently accessed members in locals
     uint32_t pc_ = pc;
     uint64_t cycles_ = cycles;
     auto& x_ = x;
+    auto& f_ = f;
     Bus* bus_ = bus;
 
-    // Local register access
-    #define REG(r) ((r) ? x_[(r)] : 0)
+    // Local register access. x0 is never written (predecode turns ALU ops
+    // with rd=x0 into NOP, loads and jumps go through SET_REG), so reads
+    // need no zero check.
+    #define REG(r) x_[(r)]
     #define SET_REG(r, v) do { if (r) x_[(r)] = (v); } while(0)
-
-    constexpr uint64_t IRQ_CHECK_INTERVAL = 4096;
-    uint64_t next_irq_check = cycles_ + IRQ_CHECK_INTERVAL;
+    #define SET_FREG(r, v) (f_[(r)] = (v))
+    #define FREG(r) fpu::to_float(f_[(r)])
+
+    DecodedInst single;  // Scratch block for code outside the cached region
+
+    // Block whose loads, stores and taken branch are still to be counted.
+    // Only recorded while hpm_insts_ is set; counted once the block is left
+    // (or before a CSR access, which may read the counters).
+    const DecodedInst* hpm_di = nullptr;
+    uint32_t hpm_pc = 0;
+    uint64_t hpm_cycles = 0;
+    #define HPM_MARK() do { \
+        if (__builtin_expect(hpm_insts_, 0)) { hpm_di = di; hpm_pc = pc_; hpm_cycles = cycles_; } \
+    } while (0)
+    #define HPM_FLUSH() do { \
+        if (__builtin_expect(hpm_di != nullptr, 0)) { \
+            count_block(hpm_di, cycles_ - hpm_cycles, hpm_pc, pc_); \
+            hpm_di = nullptr; \
+        } \
+    } while (0)
 
     while (__builtin_expect(cycles_ < target_cycles && !halted && !wfi, 1)) {
-        // Periodic interrupt check
-        if (__builtin_expect(cycles_ >= next_irq_check, 0)) {
+        HPM_FLUSH();
+
+        // Stop at the next device event. MMIO writes can move it closer,
+        // so it is re-read for every block.
+        uint64_t limit = target_cycles;
+        if (scheduler) {
+            limit = std::min(limit, scheduler->next());
+            if (__builtin_expect(cycles_ >= limit, 0)) break;
+            cycles = cycles_;  // Scheduler clock for JIT blocks (see LOAD/STORE)
+        }
+
+        // Something may have made an interrupt deliverable
+        if (__builtin_expect(irq_doorbell, 0)) {
+            irq_doorbell = false;
             pc = pc_; cycles = cycles_;
             if (check_interrupts()) {
-                cycles_++; pc_ = pc;
-                next_irq_check = cycles_ + IRQ_CHECK_INTERVAL;
+                pc_ = pc; cycles_ = cycles;
                 continue;
             }
-            next_irq_check = cycles_ + IRQ_CHECK_INTERVAL;
         }
 
-        // Fetch
-        uint32_t inst = bus_->read32(pc_);
-        uint32_t inst_len = 4;
-
-        // Compressed instruction expansion
-        if (__builtin_expect((inst & 0x3) != 0x3, 0)) {
-            inst = expand_compressed(inst & 0xFFFF);
-            inst_len = 2;
-            if (inst == 0) {
-                pc = pc_; cycles = cycles_;
-                illegal_instruction(inst);
-                pc_ = pc; cycles_ = cycles;
+        // Fetch block (one lookup per basic block)
+        uint32_t count;
+        const DecodedInst* di = block_cache_.lookup(pc_, count, *bus_);
+        if (di && jit) {
+            // Translated blocks run to completion (may overshoot the target)
+            if (const Jit::Block* jb = jit->enter(pc_, di, count)) {
+                HPM_MARK();
+                pc_ = jb->fn(x_.data());
+                cycles_ += jb->count;
                 continue;
             }
         }
-
-        // Decode
-        uint32_t op = (inst >> 2) & 0x1F;
-        uint32_t d = (inst >> 7) & 0x1F;
-        uint32_t f3 = (inst >> 12) & 0x7;
-        uint32_t r1 = (inst >> 15) & 0x1F;
-        uint32_t r2 = (inst >> 20) & 0x1F;
-        uint32_t f7 = (inst >> 25) & 0x7F;
-
-        switch (op) {
-            case 0x0C: { // OP
-                uint32_t s1 = REG(r1);
-                uint32_t s2 = REG(r2);
-                uint32_t result;
-                if (f7 == 0x01) {
-                    int32_t ss1 = static_cast<int32_t>(s1);
-                    int32_t ss2 = static_cast<int32_t>(s2);
-                    switch (f3) {
-                        case 0: result = ss1 * ss2; break;
-                        case 1: result = (static_cast<int64_t>(ss1) * ss2) >> 32; break;
-                        case 2: result = (static_cast<int64_t>(ss1) * static_cast<uint64_t>(s2)) >> 32; break;
-                        case 3: result = (static_cast<uint64_t>(s1) * s2) >> 32; break;
-                        case 4: result = s2 == 0 ? ~0u : (s1 == 0x80000000 && s2 == ~0u) ? s1 : ss1 / ss2; break;
-                        case 5: result = s2 ? s1 / s2 : ~0u; break;
-                        case 6: result = s2 == 0 ? s1 : (s1 == 0x80000000 && s2 == ~0u) ? 0 : ss1 % ss2; break;
-                        case 7: result = s2 ? s1 % s2 : s1; break;
-                        default: result = 0;
-                    }
-                } else {
-                    switch (f3) {
-                        case 0: result = (f7 & 0x20) ? s1 - s2 : s1 + s2; break;
-                        case 1: result = s1 << (s2 & 0x1F); break;
-                        case 2: result = (int32_t)s1 < (int32_t)s2; break;
-                        case 3: result = s1 < s2; break;
-                        case 4: result = s1 ^ s2; break;
-                        case 5: result = (f7 & 0x20) ? (uint32_t)((int32_t)s1 >> (s2 & 0x1F)) : s1 >> (s2 & 0x1F); break;
-                        case 6: result = s1 | s2; break;
-                        case 7: result = s1 & s2; break;
-                        default: result = 0;
-                    }
-                }
-                SET_REG(d, result);
-                pc_ += inst_len;
-                cycles_++;
-                continue;
+        if (__builtin_expect(!di, 0)) {
+            uint32_t inst = bus_->read32(pc_);
+            uint32_t len = 4;
+            if (is_compressed(inst)) {
+                inst = expand_compressed(inst & 0xFFFF);
+                len = 2;
             }
+            single = predecode(inst, len, bitmanip_);
+            di = &single;
+            count = 1;
+        }
 
-            case 0x04: { // OP_IMM
-                uint32_t s1 = REG(r1);
-                int32_t imm = (int32_t)inst >> 20;
-                uint32_t shamt = imm & 0x1F;
-                uint32_t result;
-                switch (f3) {
-                    case 0: result = s1 + imm; break;
-                    case 1: result = s1 << shamt; break;
-                    case 2: result = (int32_t)s1 < imm; break;
-                    case 3: result = s1 < (uint32_t)imm; break;
-                    case 4: result = s1 ^ imm; break;
-                    case 5: result = (inst & (1 << 30)) ? (uint32_t)((int32_t)s1 >> shamt) : s1 >> shamt; break;
-                    case 6: result = s1 | imm; break;
-                    case 7: result = s1 & imm; break;
-                    default: result = 0;
-                }
-                SET_REG(d, result);
-                pc_ += inst_len;
-                cycles_++;
-                continue;
-            }
+        // Don't run past the target in the middle of a long block
+        if (count > limit - cycles_) {
+            count = static_cast<uint32_t>(limit - cycles_);
+        }
+        HPM_MARK();
+
+        // Execute. Only the last instruction of a block can change control
+        // flow; it sets pc_ itself and uses `continue` to leave the block.
+        // Every other handler ends in NEXT(), which advances PC and cycles
+        // and dispatches the next instruction of the block.
+        //
+        // With COSMO_THREADED_DISPATCH each handler jumps straight to the
+        // next one through dispatch_table (computed goto), giving the host
+        // one indirect branch per handler instead of one shared switch
+        // jump. Otherwise the same handlers are cases of a plain switch.
+        const DecodedInst* const end = di + count;
+        uint32_t d, r1, r2;
+        int32_t imm;
+
+#ifdef COSMO_THREADED_DISPATCH
+        // Must list the labels in Uop order
+        static const void* const dispatch_table[] = {
+            &&op_NOP,
+            &&op_ADD, &&op_SUB, &&op_SLL, &&op_SLT, &&op_SLTU,
+            &&op_XOR, &&op_SRL, &&op_SRA, &&op_OR, &&op_AND,
+            &&op_MUL, &&op_MULH, &&op_MULHSU, &&op_MULHU,
+            &&op_DIV, &&op_DIVU, &&op_REM, &&op_REMU,
+            &&op_ADDI, &&op_SLTI, &&op_SLTIU, &&op_XORI, &&op_ORI,
+            &&op_ANDI, &&op_SLLI, &&op_SRLI, &&op_SRAI,
+            &&op_SH1ADD, &&op_SH2ADD, &&op_SH3ADD,
+            &&op_ANDN, &&op_ORN, &&op_XNOR, &&op_MIN, &&op_MINU, &&op_MAX, &&op_MAXU,
+            &&op_ROL, &&op_ROR, &&op_RORI,
+            &&op_CLZ, &&op_CTZ, &&op_CPOP, &&op_SEXTB, &&op_SEXTH, &&op_ZEXTH,
+            &&op_ORCB, &&op_REV8,
+            &&op_BCLR, &&op_BEXT, &&op_BINV, &&op_BSET,
+            &&op_BCLRI, &&op_BEXTI, &&op_BINVI, &&op_BSETI,
+            &&op_LB, &&op_LH, &&op_LW, &&op_LBU, &&op_LHU,
+            &&op_SB, &&op_SH, &&op_SW,
+            &&op_LUI, &&op_AUIPC,
+            &&op_FLW, &&op_FSW,
+            &&op_FADD, &&op_FSUB, &&op_FMUL, &&op_FDIV,
+            &&op_FMADD, &&op_FMSUB, &&op_FNMSUB, &&op_FNMADD,
+            &&op_FP,
+            &&op_BEQ, &&op_BNE, &&op_BLT, &&op_BGE, &&op_BLTU, &&op_BGEU,
+            &&op_JAL, &&op_JALR,
+            &&op_SYSTEM,
+            &&op_AMO,
+            &&op_ILLEGAL,
+        };
+        static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) ==
+                      static_cast<size_t>(Uop::ILLEGAL) + 1,
+                      "dispatch_table out of sync with Uop");
+
+        #define DISPATCH() do { \
+            d = di->rd; r1 = di->rs1; r2 = di->rs2; imm = di->imm; \
+            goto *dispatch_table[static_cast<uint8_t>(di->op)]; \
+        } while (0)
+        #define CASE(op) op_##op
+#else
+        #define DISPATCH() goto dispatch
+        #define CASE(op) case Uop::op
+#endif
+        // Plain block, not do/while: `continue` must reach the block loop
+        #define NEXT() { \
+            pc_ += di->len; cycles_++; \
+            if (++di == end) continue; \
+            DISPATCH(); \
+        }
+        // Loads and stores that leave the memory fast path may hit a device:
+        // publish the exact cycle for it first. A store may also ring the
+        // doorbell; then leave the block so a now deliverable interrupt is
+        // taken before the next instruction.
+        #define LOAD(set, w, T) { \
+            uint32_t a = REG(r1) + imm, v; \
+            if (__builtin_expect(!bus_->try_read(a, w, v), 0)) { \
+                cycles = cycles_; \
+                v = bus_->read_slow(a, w); \
+            } \
+            set(d, (T)v); \
+        }
+        #define STORE(w, src) { \
+            uint32_t a = REG(r1) + imm; \
+            if (__builtin_expect(!bus_->try_write(a, w, src), 0)) { \
+                cycles = cycles_; \
+                bus_->write_slow(a, w, src); \
+                if (irq_doorbell) { \
+                    pc_ += di->len; cycles_++; \
+                    continue; \
+                } \
+            } \
+        }
+        // FP arithmetic in round-to-nearest-even (the host default), any
+        // other rounding mode goes through exec_fp
+        #define FP_OP(expr) { \
+            uint32_t rm = imm & 0x7; \
+            if (rm == fpu::DYN) rm = fcsr >> 5; \
+            if (__builtin_expect(rm != fpu::RNE, 0)) goto fp_generic; \
+            f_[d] = fpu::result(expr); \
+            NEXT(); \
+        }
 
-            case 0x00: { // LOAD
-                uint32_t addr = REG(r1) + ((int32_t)inst >> 20);
-                uint32_t result;
-                switch (f3) {
-                    case 0: result = (int8_t)bus_->read8(addr); break;
-                    case 1: result = (int16_t)bus_->read16(addr); break;
-                    case 2: result = bus_->read32(addr); break;
-                    case 4: result = bus_->read8(addr); break;
-                    case 5: result = bus_->read16(addr); break;
-                    default: result = 0;
-                }
-                SET_REG(d, result);
-                pc_ += inst_len;
-                cycles_++;
-                continue;
+#ifdef COSMO_THREADED_DISPATCH
+        DISPATCH();
+        {
+#else
+    dispatch:
+        d = di->rd; r1 = di->rs1; r2 = di->rs2; imm = di->imm;
+        switch (di->op) {
+#endif
+            CASE(NOP): NEXT();
+
+            // OP
+            CASE(ADD):  x_[d] = REG(r1) + REG(r2); NEXT();
+            CASE(SUB):  x_[d] = REG(r1) - REG(r2); NEXT();
+            CASE(SLL):  x_[d] = REG(r1) << (REG(r2) & 0x1F); NEXT();
+            CASE(SLT):  x_[d] = (int32_t)REG(r1) < (int32_t)REG(r2); NEXT();
+            CASE(SLTU): x_[d] = REG(r1) < REG(r2); NEXT();
+            CASE(XOR):  x_[d] = REG(r1) ^ REG(r2); NEXT();
+            CASE(SRL):  x_[d] = REG(r1) >> (REG(r2) & 0x1F); NEXT();
+            CASE(SRA):  x_[d] = (uint32_t)((int32_t)REG(r1) >> (REG(r2) & 0x1F)); NEXT();
+            CASE(OR):   x_[d] = REG(r1) | REG(r2); NEXT();
+            CASE(AND):  x_[d] = REG(r1) & REG(r2); NEXT();
+
+            // RV32M
+            CASE(MUL):
+                x_[d] = (int32_t)REG(r1) * (int32_t)REG(r2);
+                NEXT();
+            CASE(MULH):
+                x_[d] = (static_cast<int64_t>((int32_t)REG(r1)) * (int32_t)REG(r2)) >> 32;
+                NEXT();
+            CASE(MULHSU):
+                x_[d] = (static_cast<int64_t>((int32_t)REG(r1)) * static_cast<uint64_t>(REG(r2))) >> 32;
+                NEXT();
+            CASE(MULHU):
+                x_[d] = (static_cast<uint64_t>(REG(r1)) * REG(r2)) >> 32;
+                NEXT();
+            CASE(DIV): {
+                uint32_t s1 = REG(r1), s2 = REG(r2);
+                x_[d] = s2 == 0 ? ~0u : (s1 == 0x80000000 && s2 == ~0u) ? s1 : (int32_t)s1 / (int32_t)s2;
+                NEXT();
             }
-
-            case 0x08: { // STORE
-                int32_t offset = ((int32_t)(inst & 0xFE000000) >> 20) | ((inst >> 7) & 0x1F);
-                uint32_t addr = REG(r1) + offset;
-                uint32_t src = REG(r2);
-                switch (f3) {
-                    case 0: bus_->write8(addr, src); break;
-                    case 1: bus_->write16(addr, src); break;
-                    case 2: bus_->write32(addr, src); break;
-                }
-                pc_ += inst_len;
-                cycles_++;
-                continue;
+            CASE(DIVU): {
+                uint32_t s1 = REG(r1), s2 = REG(r2);
+                x_[d] = s2 ? s1 / s2 : ~0u;
+                NEXT();
             }
-
-            case 0x18: { // BRANCH
-                uint32_t s1 = REG(r1);
-                uint32_t s2 = REG(r2);
-                int32_t offset = ((int32_t)(inst & 0x80000000) >> 19) |
-                                 ((inst & 0x80) << 4) | ((inst >> 20) & 0x7E0) | ((inst >> 7) & 0x1E);
-                bool taken;
-                switch (f3) {
-                    case 0: taken = s1 == s2; break;
-                    case 1: taken = s1 != s2; break;
-                    case 4: taken = (int32_t)s1 < (int32_t)s2; break;
-                    case 5: taken = (int32_t)s1 >= (int32_t)s2; break;
-                    case 6: taken = s1 < s2; break;
-                    case 7: taken = s1 >= s2; break;
-                    default: taken = false;
-                }
-                pc_ = taken ? pc_ + offset : pc_ + inst_len;
-                cycles_++;
-                continue;
+            CASE(REM): {
+                uint32_t s1 = REG(r1), s2 = REG(r2);
+                x_[d] = s2 == 0 ? s1 : (s1 == 0x80000000 && s2 == ~0u) ? 0 : (int32_t)s1 % (int32_t)s2;
+                NEXT();
+            }
+            CASE(REMU): {
+                uint32_t s1 = REG(r1), s2 = REG(r2);
+                x_[d] = s2 ? s1 % s2 : s1;
+                NEXT();
             }
 
-            case 0x1B: { // JAL
-                int32_t offset = ((int32_t)(inst & 0x80000000) >> 11) |
-                                 (inst & 0xFF000) | ((inst >> 9) & 0x800) | ((inst >> 20) & 0x7FE);
-                SET_REG(d, pc_ + inst_len);
-                pc_ += offset;
+            // OP_IMM (shift amounts are predecoded into imm)
+            CASE(ADDI):  x_[d] = REG(r1) + imm; NEXT();
+            CASE(SLTI):  x_[d] = (int32_t)REG(r1) < imm; NEXT();
+            CASE(SLTIU): x_[d] = REG(r1) < (uint32_t)imm; NEXT();
+            CASE(XORI):  x_[d] = REG(r1) ^ imm; NEXT();
+            CASE(ORI):   x_[d] = REG(r1) | imm; NEXT();
+            CASE(ANDI):  x_[d] = REG(r1) & imm; NEXT();
+            CASE(SLLI):  x_[d] = REG(r1) << imm; NEXT();
+            CASE(SRLI):  x_[d] = REG(r1) >> imm; NEXT();
+            CASE(SRAI):  x_[d] = (uint32_t)((int32_t)REG(r1) >> imm); NEXT();
+
+            // Zba/Zbb/Zbs
+            #define BITMANIP(op, b) CASE(op): x_[d] = bitmanip_op(Uop::op, REG(r1), b); NEXT();
+            BITMANIP(SH1ADD, REG(r2)) BITMANIP(SH2ADD, REG(r2)) BITMANIP(SH3ADD, REG(r2))
+            BITMANIP(ANDN, REG(r2))   BITMANIP(ORN, REG(r2))    BITMANIP(XNOR, REG(r2))
+            BITMANIP(MIN, REG(r2))    BITMANIP(MINU, REG(r2))
+            BITMANIP(MAX, REG(r2))    BITMANIP(MAXU, REG(r2))
+            BITMANIP(ROL, REG(r2))    BITMANIP(ROR, REG(r2))    BITMANIP(RORI, imm)
+            BITMANIP(CLZ, 0)          BITMANIP(CTZ, 0)          BITMANIP(CPOP, 0)
+            BITMANIP(SEXTB, 0)        BITMANIP(SEXTH, 0)        BITMANIP(ZEXTH, 0)
+            BITMANIP(ORCB, 0)         BITMANIP(REV8, 0)
+            BITMANIP(BCLR, REG(r2))   BITMANIP(BEXT, REG(r2))
+            BITMANIP(BINV, REG(r2))   BITMANIP(BSET, REG(r2))
+            BITMANIP(BCLRI, imm)      BITMANIP(BEXTI, imm)
+            BITMANIP(BINVI, imm)      BITMANIP(BSETI, imm)
+            #undef BITMANIP
+
+            // LOAD
+            CASE(LB):  LOAD(SET_REG, Width::Byte, int8_t); NEXT();
+            CASE(LH):  LOAD(SET_REG, Width::Half, int16_t); NEXT();
+            CASE(LW):  LOAD(SET_REG, Width::Word, uint32_t); NEXT();
+            CASE(LBU): LOAD(SET_REG, Width::Byte, uint32_t); NEXT();
+            CASE(LHU): LOAD(SET_REG, Width::Half, uint32_t); NEXT();
+
+            // STORE
+            CASE(SB): STORE(Width::Byte, REG(r2)); NEXT();
+            CASE(SH): STORE(Width::Half, REG(r2)); NEXT();
+            CASE(SW): STORE(Width::Word, REG(r2)); NEXT();
+
+            CASE(LUI):   x_[d] = imm; NEXT();
+            CASE(AUIPC): x_[d] = pc_ + imm; NEXT();
+
+            // RV32F
+            CASE(FLW): LOAD(SET_FREG, Width::Word, uint32_t); NEXT();
+            CASE(FSW): STORE(Width::Word, f_[r2]); NEXT();
+            CASE(FADD):   FP_OP(FREG(r1) + FREG(r2));
+            CASE(FSUB):   FP_OP(FREG(r1) - FREG(r2));
+            CASE(FMUL):   FP_OP(FREG(r1) * FREG(r2));
+            CASE(FDIV):   FP_OP(FREG(r1) / FREG(r2));
+            CASE(FMADD):  FP_OP(std::fma(FREG(r1), FREG(r2), FREG(imm >> 3)));
+            CASE(FMSUB):  FP_OP(std::fma(FREG(r1), FREG(r2), -FREG(imm >> 3)));
+            CASE(FNMSUB): FP_OP(std::fma(-FREG(r1), FREG(r2), FREG(imm >> 3)));
+            CASE(FNMADD): FP_OP(std::fma(-FREG(r1), FREG(r2), -FREG(imm >> 3)));
+            CASE(FP):
+            fp_generic:
+                pc = pc_; cycles = cycles_;
+                if (__builtin_expect(!exec_fp(di->inst), 0)) {
+                    pc_ = pc; cycles_ = cycles;
+                    goto exit;
+                }
+                NEXT();
+
+            // BRANCH
+            CASE(BEQ):  pc_ += REG(r1) == REG(r2) ? imm : di->len; cycles_++; continue;
+            CASE(BNE):  pc_ += REG(r1) != REG(r2) ? imm : di->len; cycles_++; continue;
+            CASE(BLT):  pc_ += (int32_t)REG(r1) < (int32_t)REG(r2) ? imm : di->len; cycles_++; continue;
+            CASE(BGE):  pc_ += (int32_t)REG(r1) >= (int32_t)REG(r2) ? imm : di->len; cycles_++; continue;
+            CASE(BLTU): pc_ += REG(r1) < REG(r2) ? imm : di->len; cycles_++; continue;
+            CASE(BGEU): pc_ += REG(r1) >= REG(r2) ? imm : di->len; cycles_++; continue;
+
+            CASE(JAL):
+                SET_REG(d, pc_ + di->len);
+                pc_ += imm;
                 cycles_++;
                 continue;
-            }
 
-            case 0x19: { // JALR
-                uint32_t base = REG(r1);
-                int32_t offset = (int32_t)inst >> 20;
-                uint32_t target = (base + offset) & ~1u;
-                SET_REG(d, pc_ + inst_len);
+            CASE(JALR): {
+                uint32_t target = (REG(r1) + imm) & ~1u;
+                SET_REG(d, pc_ + di->len);
                 pc_ = target;
                 cycles_++;
                 continue;
             }
 
-            case 0x0D: // LUI
-                SET_REG(d, inst & 0xFFFFF000);
-                pc_ += inst_len;
-                cycles_++;
-                continue;
-
-            case 0x05: // AUIPC
-                SET_REG(d, pc_ + (inst & 0xFFFFF000));
-                pc_ += inst_len;
-                cycles_++;
-                continue;
-
-            case 0x1C: { // SYSTEM
+            CASE(SYSTEM):
+                HPM_FLUSH();
                 pc = pc_; cycles = cycles_;
-                inst_len_ = inst_len;
-                uint32_t f3_sys = (inst >> 12) & 0x7;
-                exec_system(inst);
+                inst_len_ = di->len;
+                exec_system(di->inst);
                 pc_ = pc; cycles_ = cycles;
-                if (wfi) goto exit;
-                // CSR instructions (funct3 != 0) need PC increment
                 // ECALL/EBREAK/MRET/WFI (funct3 == 0) handle PC themselves
-                if (f3_sys != 0) {
-                    pc_ += inst_len;
-                    cycles_++;
-                }
+                // and end the batch, so callers see traps (mcause) and
+                // WFI right away
+                if (funct3(di->inst) == 0) goto exit;
+                // CSR instructions need PC increment
+                pc_ += di->len;
+                cycles_++;
                 continue;
-            }
 
-            case 0x0B: // AMO
+            CASE(AMO):
                 pc = pc_; cycles = cycles_;
-                inst_len_ = inst_len;
-                exec_amo(inst);
+                inst_len_ = di->len;
+                exec_amo(di->inst);
                 pc_ = pc; cycles_ = cycles;
-                pc_ += inst_len;
-                cycles_++;
-                continue;
-
-            case 0x03: // MISC_MEM (FENCE)
-                pc_ += inst_len;
+                pc_ += di->len;
                 cycles_++;
                 continue;
 
-            default:
+            CASE(ILLEGAL):
                 pc = pc_; cycles = cycles_;
-                illegal_instruction(inst);
+                illegal_instruction(di->inst);
                 pc_ = pc; cycles_ = cycles;
-                continue;
+                goto exit;
         }
+
+        #undef DISPATCH
+        #undef CASE
+        #undef NEXT
+        #undef LOAD
+        #undef STORE
+        #undef FP_OP
     }
 
 exit:
+    HPM_FLUSH();
     pc = pc_;
     cycles = cycles_;
+    sync_fflags();
 
     #undef REG
     #undef SET_REG
+    #undef SET_FREG
+    #undef FREG
+    #undef HPM_MARK
+    #undef HPM_FLUSH
 }
 
-void CPU::exec_op(uint32_t inst) {
+bool CPU::exec_op(uint32_t inst) {
+    if (bitmanip_ && exec_bitmanip(inst)) return true;
+    if (!base_funct7(inst)) {
+        illegal_instruction(inst);
+        return false;
+    }
+
     uint32_t d = rd(inst);
     uint32_t s1 = reg(rs1(inst));
     uint32_t s2 = reg(rs2(inst));
@@ -553,13 +959,20 @@ void CPU::exec_op(uint32_t inst) {
     }
 
     set_reg(d, result);
+    return true;
 }
 
-void CPU::exec_op_imm(uint32_t inst) {
+bool CPU::exec_op_imm(uint32_t inst) {
+    if (bitmanip_ && exec_bitmanip(inst)) return true;
+    uint32_t f3 = funct3(inst);
+    if ((f3 == 1 || f3 == 5) && !base_funct7(inst)) {
+        illegal_instruction(inst);
+        return false;
+    }
+
     uint32_t d = rd(inst);
     uint32_t s1 = reg(rs1(inst));
     int32_t imm = imm_i(inst);
-    uint32_t f3 = funct3(inst);
     uint32_t shamt = imm & 0x1F;
 
 
@@ -596,6 +1009,7 @@ void CPU::exec_op_imm(uint32_t inst) {
     }
 
     set_reg(d, result);
+    return true;
 }
 
 void CPU::exec_load(uint32_t inst) {
@@ -605,6 +1019,8 @@ void CPU::exec_load(uint32_t inst) {
     uint32_t addr = base + offset;
     uint32_t f3 = funct3(inst);
 
+    if (hpm_insts_) hpm_count(HpmEvent::Load);
+
     uint32_t result = 0;
 
     switch (f3) {
@@ -665,6 +1081,8 @@ void CPU::exec_store(uint32_t inst) {
     uint32_t addr = base + offset;
     uint32_t f3 = funct3(inst);
 
+    if (hpm_insts_) hpm_count(HpmEvent::Store);
+
     switch (f3) {
         case 0b000: // SB
             bus->write8(addr, src);
@@ -723,6 +1141,7 @@ void CPU::exec_branch(uint32_t inst) {
     }
 
     if (taken) {
+        if (hpm_insts_) hpm_count(HpmEvent::TakenBranch);
         uint32_t target = pc + offset;
         if (target & 0x1) {
             take_trap(TrapCause::InstructionAddressMisaligned);
@@ -885,6 +1304,148 @@ void CPU::exec_misc_mem(uint32_t) {
     // FENCE - NOP for single-hart
 }
 
+bool CPU::exec_bitmanip(uint32_t inst) {
+    Uop op = decode_bitmanip(inst);
+    if (op == Uop::ILLEGAL) return false;
+    bool imm = opcode(inst) == static_cast<uint32_t>(OpType::OP_IMM);
+    set_reg(rd(inst), bitmanip_op(op, reg(rs1(inst)), imm ? rs2(inst) : reg(rs2(inst))));
+    return true;
+}
+
+bool CPU::exec_fp(uint32_t inst) {
+    uint32_t op = opcode(inst);
+    uint32_t d = rd(inst);
+    uint32_t s1 = rs1(inst);
+    uint32_t s2 = rs2(inst);
+    uint32_t f3 = funct3(inst);
+    uint32_t f7 = funct7(inst);
+
+    // FLW / FSW
+    if (op == static_cast<uint32_t>(OpType::LOAD_FP) || op == static_cast<uint32_t>(OpType::STORE_FP)) {
+        if (f3 != 0b010) {
+            illegal_instruction(inst);
+            return false;
+        }
+        if (op == static_cast<uint32_t>(OpType::LOAD_FP)) {
+            if (hpm_insts_) hpm_count(HpmEvent::Load);
+            f[d] = bus->read32(reg(s1) + imm_i(inst));
+        } else {
+            if (hpm_insts_) hpm_count(HpmEvent::Store);
+            bus->write32(reg(s1) + imm_s(inst), f[s2]);
+        }
+        return true;
+    }
+
+    // Rounding mode for the instructions that round
+    uint32_t rm = f3 == fpu::DYN ? fcsr >> 5 : f3;
+    bool rm_valid = rm <= fpu::RMM;
+    uint32_t flags = 0;
+    float a = fpu::to_float(f[s1]);
+    float b = fpu::to_float(f[s2]);
+
+    if (op != static_cast<uint32_t>(OpType::OP_FP)) {
+        // FMADD / FMSUB / FNMSUB / FNMADD (fmt must be S)
+        if ((f7 & 0x3) != 0 || !rm_valid) {
+            illegal_instruction(inst);
+            return false;
+        }
+        float c = fpu::to_float(f[rs3(inst)]);
+        uint32_t variant = (op >> 2) & 0x3;
+        if (variant >= 2) a = -a;
+        if (variant & 1) c = -c;
+        if (rm == fpu::RMM) {
+            f[d] = fpu::result(fpu::rmm([&] {
+                volatile double va = a, vb = b, vc = c;
+                return std::fma(va, vb, vc);
+            }));
+            return true;
+        }
+        fpu::Rounding round(rm);
+        volatile float va = a, vb = b, vc = c;
+        volatile float r = std::fma(va, vb, vc);
+        f[d] = fpu::result(r);
+        return true;
+    }
+
+    switch (f7) {
+        case 0x00:   // FADD.S
+        case 0x04:   // FSUB.S
+        case 0x08:   // FMUL.S
+        case 0x0C:   // FDIV.S
+        case 0x2C: { // FSQRT.S
+            if (!rm_valid || (f7 == 0x2C && s2 != 0)) break;
+            if (rm == fpu::RMM) {
+                f[d] = fpu::result(fpu::rmm([&] {
+                    volatile double va = a, vb = b;
+                    return f7 == 0x00 ? va + vb :
+                           f7 == 0x04 ? va - vb :
+                           f7 == 0x08 ? va * vb :
+                           f7 == 0x0C ? va / vb : std::sqrt(va);
+                }));
+                return true;
+            }
+            fpu::Rounding round(rm);
+            volatile float va = a, vb = b;
+            volatile float r = f7 == 0x00 ? va + vb :
+                               f7 == 0x04 ? va - vb :
+                               f7 == 0x08 ? va * vb :
+                               f7 == 0x0C ? va / vb : std::sqrt(va);
+            f[d] = fpu::result(r);
+            return true;
+        }
+        case 0x10: { // FSGNJ.S / FSGNJN.S / FSGNJX.S
+            uint32_t sign = f[s2] & fpu::SIGN;
+            uint32_t mag = f[s1] & ~fpu::SIGN;
+            if (f3 == 0) f[d] = mag | sign;
+            else if (f3 == 1) f[d] = mag | (sign ^ fpu::SIGN);
+            else if (f3 == 2) f[d] = f[s1] ^ sign;
+            else break;
+            return true;
+        }
+        case 0x14:   // FMIN.S / FMAX.S
+            if (f3 > 1) break;
+            f[d] = fpu::min_max(f[s1], f[s2], f3 == 1, flags);
+            fcsr |= flags;
+            return true;
+        case 0x50:   // FLE.S / FLT.S / FEQ.S
+            if (f3 > 2) break;
+            set_reg(d, fpu::compare(f[s1], f[s2], f3, flags));
+            fcsr |= flags;
+            return true;
+        case 0x60:   // FCVT.W.S / FCVT.WU.S
+            if (!rm_valid || s2 > 1) break;
+            set_reg(d, fpu::to_int(f[s1], rm, s2 == 0, flags));
+            fcsr |= flags;
+            return true;
+        case 0x68: { // FCVT.S.W / FCVT.S.WU
+            if (!rm_valid || s2 > 1) break;
+            if (rm == fpu::RMM) {
+                f[d] = fpu::to_bits(fpu::rmm([&] {
+                    uint32_t v = reg(s1);
+                    return s2 == 0 ? static_cast<double>(static_cast<int32_t>(v)) : static_cast<double>(v);
+                }));
+                return true;
+            }
+            fpu::Rounding round(rm);
+            volatile uint32_t v = reg(s1);
+            volatile float r = s2 == 0 ? static_cast<float>(static_cast<int32_t>(v)) : static_cast<float>(v);
+            f[d] = fpu::to_bits(r);
+            return true;
+        }
+        case 0x70:   // FMV.X.W / FCLASS.S
+            if (s2 != 0 || f3 > 1) break;
+            set_reg(d, f3 == 0 ? f[s1] : fpu::classify(f[s1]));
+            return true;
+        case 0x78:   // FMV.W.X
+            if (s2 != 0 || f3 != 0) break;
+            f[d] = reg(s1);
+            return true;
+    }
+
+    illegal_instruction(inst);
+    return false;
+}
+
 void CPU::illegal_instruction(uint32_t inst) {
     std::fprintf(stderr, "[CPU] Illegal instruction at PC=0x%08X: 0x%08X\n", pc, inst);
     take_trap(TrapCause::IllegalInstruction, inst);
@@ -1,12 +1,15 @@
 #pragma once
 #include "bus.hpp"
+#include "block_cache.hpp"
 #include <cstdint>
 #include <array>
 
 namespace cosmo {
 
-// Forward declaration
+// Forward declarations
 class PFIC;
+class Jit;
+class Scheduler;
 
 // Trap causes (exceptions)
 enum class TrapCause : uint32_t {
@@ -32,6 +35,9 @@ enum class InterruptCause : uint32_t {
 
 // CSR addresses
 enum class CSR : uint32_t {
+    fflags  = 0x001,
+    frm     = 0x002,
+    fcsr    = 0x003,
     mstatus = 0x300,
     mie     = 0x304,
     mtvec   = 0x305,
@@ -39,6 +45,38 @@ enum class CSR : uint32_t {
     mcause  = 0x342,
     mtval   = 0x343,
     mip     = 0x344,
+
+    // Counters and their user-mode shadows (see csr_read)
+    mcountinhibit = 0x320,
+    mhpmevent3    = 0x323,
+    mcycle        = 0xB00,
+    minstret      = 0xB02,
+    mhpmcounter3  = 0xB03,
+    mcycleh       = 0xB80,
+    minstreth     = 0xB82,
+    mhpmcounter3h = 0xB83,
+    cycle         = 0xC00,
+    time          = 0xC01,
+    instret       = 0xC02,
+    hpmcounter3   = 0xC03,
+    cycleh        = 0xC80,
+    timeh         = 0xC81,
+    instreth      = 0xC82,
+    hpmcounter3h  = 0xC83,
+
+    // QingKe vendor CSRs
+    intsyscr      = 0x804,  // Interrupt system control
+};
+
+// Events selectable in mhpmevent3..mhpmevent6
+enum class HpmEvent : uint32_t {
+    None = 0,
+    Load = 1,         // Load instructions retired
+    Store = 2,        // Store instructions retired
+    TakenBranch = 3,  // Conditional branches taken
+    Mmio = 4,         // Bus accesses handled by a device (includes DMA)
+    Interrupt = 5,    // Interrupts taken
+    Count
 };
 
 // MIE/MIP bit positions
@@ -46,10 +84,19 @@ constexpr uint32_t MIE_MSIE = 1 << 3;   // Machine software interrupt enable
 constexpr uint32_t MIE_MTIE = 1 << 7;   // Machine timer interrupt enable
 constexpr uint32_t MIE_MEIE = 1 << 11;  // Machine external interrupt enable
 
+// mstatus.FS (FPU state). Stored for software, FP instructions are
+// accepted in any state.
+constexpr uint32_t MSTATUS_FS = 3 << 13;
+
+// intsyscr bits
+constexpr uint32_t INTSYSCR_HWSTKEN = 1 << 0;  // Hardware stacking (HPE) enable
+constexpr uint32_t INTSYSCR_INESTEN = 1 << 1;  // Interrupt nesting enable
+
 class CPU {
 public:
     // State
     std::array<uint32_t, 32> x{};  // General purpose registers
+    std::array<uint32_t, 32> f{};  // Float registers (IEEE-754 single bits)
     uint32_t pc = 0;
     uint64_t cycles = 0;
 
@@ -61,6 +108,8 @@ public:
     uint32_t mcause = 0;
     uint32_t mtval = 0;
     uint32_t mip = 0;
+    uint32_t fcsr = 0;  // frm[7:5], fflags[4:0] (see sync_fflags)
+    uint32_t intsyscr = 0;
 
     // Atomics reservation
     uint32_t reservation_addr = 0xFFFFFFFF;
@@ -72,6 +121,18 @@ public:
     // PFIC reference (optional, for external interrupts)
     PFIC* pfic = nullptr;
 
+    // JIT backend (optional, used by run() for hot blocks)
+    Jit* jit = nullptr;
+
+    // Device event scheduler (optional, run() stops at its next event)
+    Scheduler* scheduler = nullptr;
+
+    // Interrupt doorbell: set by the PFIC and by writes to interrupt CSRs
+    // whenever an interrupt may have become deliverable. run() checks for
+    // interrupts only when it is set, at the next block boundary or right
+    // after the store that rang it.
+    bool irq_doorbell = true;
+
     // Halted state
     bool halted = false;
     bool wfi = false;  // Wait for interrupt
@@ -81,7 +142,10 @@ public:
 
     explicit CPU(Bus* b) : bus(b) {}
 
-    void set_pfic(PFIC* p) { pfic = p; }
+    void set_pfic(PFIC* p);
+    void set_jit(Jit* j);
+    void set_bitmanip(bool on);  // Zba/Zbb/Zbs (not on the CH32V307)
+    void set_scheduler(Scheduler* s) { scheduler = s; }
 
     // Register access (x0 always 0)
     uint32_t reg(uint32_t r) const { return r ? x[r] : 0; }
@@ -93,7 +157,7 @@ public:
 
     // Trap handling
     void take_trap(TrapCause cause, uint32_t tval = 0);
-    void take_interrupt(InterruptCause cause);
+    void take_interrupt(InterruptCause cause, uint32_t vtf = 0);  // vtf: PFIC VTF entry
     void mret();
 
     // Execution
@@ -105,12 +169,93 @@ public:
     // Interrupt check - returns true if interrupt was taken
     bool check_interrupts();
 
+    // Let time pass while waiting in WFI (counts as cycles, not instret)
+    void idle(uint64_t until);
+
     // Check if interrupts are globally enabled
     bool interrupts_enabled() const { return mstatus & 0x8; }
 
+    static constexpr uint32_t HPM_COUNTERS = 4;  // mhpmcounter3..6
+    static constexpr uint32_t HPE_DEPTH = 3;     // Hardware stack levels
+    static constexpr uint32_t HPE_REGS = 16;     // ra, t0-t6, a0-a7
+    static constexpr uint32_t NEST_DEPTH = 2;    // PFIC interrupt nesting levels
+
 private:
-    void exec_op(uint32_t inst);
-    void exec_op_imm(uint32_t inst);
+    // Predecoded basic blocks for run()
+    BlockCache block_cache_;
+
+    bool bitmanip_ = false;
+
+    // Counter CSRs. mcycle, minstret and time are derived from `cycles`:
+    // every instruction takes one cycle, so instret only has to leave out
+    // the cycles that retired nothing (interrupt entry, idling in WFI).
+    // Writes store an offset.
+    uint64_t stalled_ = 0;
+    uint64_t cycle_offset_ = 0;
+    uint64_t instret_offset_ = 0;
+
+    // Hardware performance monitors. Each counter reads as the running
+    // total of its event minus `base`. Loads, stores and taken branches
+    // are only tallied while some counter selects one of them (run()
+    // then counts per executed block), so they cost nothing otherwise.
+    struct HpmCounter {
+        HpmEvent event = HpmEvent::None;
+        uint64_t base = 0;
+    };
+    std::array<HpmCounter, HPM_COUNTERS> hpm_{};
+    std::array<uint64_t, static_cast<size_t>(HpmEvent::Count)> hpm_events_{};
+    bool hpm_insts_ = false;  // Tally loads, stores and taken branches
+
+    // Hardware prologue/epilogue (HPE). With intsyscr.HWSTKEN set, taking
+    // an interrupt pushes the caller-saved registers onto an internal stack
+    // and the MRET that returns from it pops them, so handlers need not
+    // spill them. Frames remember the trap depth they were pushed at: an
+    // MRET from an exception handler leaves them alone. When the stack is
+    // full the interrupt is taken without stacking.
+    struct HpeFrame {
+        std::array<uint32_t, HPE_REGS> regs;
+        uint32_t depth;
+    };
+    std::array<HpeFrame, HPE_DEPTH> hpe_{};
+    uint32_t hpe_top_ = 0;
+    uint32_t trap_depth_ = 0;  // Traps taken and not yet returned from
+
+    void hpe_push();
+    void hpe_pop();
+
+    // PFIC interrupts being serviced, innermost last. Entry marks the IRQ
+    // active in the PFIC and the MRET returning from it (matched by trap
+    // depth, as for HPE) clears it again. While one is active, only an IRQ
+    // of strictly higher priority (lower number) can preempt it, and only
+    // with intsyscr.INESTEN set and fewer than NEST_DEPTH levels in use.
+    // Nesting leaves mstatus.MIE set on entry, so a handler that clears it
+    // cannot be preempted until it sets it again or returns. The preempted
+    // handler's mepc, mcause and MPIE are kept here and restored when the
+    // nested one returns.
+    struct IrqLevel {
+        uint32_t irq;
+        uint32_t depth;
+        uint32_t mepc;
+        uint32_t mcause;
+        uint32_t mpie;
+    };
+    std::array<IrqLevel, NEST_DEPTH> irq_levels_{};
+    uint32_t irq_top_ = 0;
+
+    bool preempts(uint32_t irq) const;
+    void enter_irq(uint32_t irq);
+
+    uint64_t event_total(HpmEvent e) const;
+    uint64_t counter_read(uint32_t index) const;
+    void counter_write(uint32_t index, uint64_t val);
+    void hpm_select(uint32_t index, uint32_t event);
+    void hpm_count(HpmEvent e, uint64_t n = 1) {
+        hpm_events_[static_cast<size_t>(e)] += n;
+    }
+    void count_block(const DecodedInst* di, uint64_t n, uint32_t block_pc, uint32_t next_pc);
+
+    bool exec_op(uint32_t inst);      // False if it trapped
+    bool exec_op_imm(uint32_t inst);  // False if it trapped
     void exec_load(uint32_t inst);
     void exec_store(uint32_t inst);
     void exec_branch(uint32_t inst);
@@ -121,6 +266,12 @@ private:
     void exec_system(uint32_t inst);
     void exec_amo(uint32_t inst);
     void exec_misc_mem(uint32_t inst);
+    bool exec_bitmanip(uint32_t inst);  // False if not a Zba/Zbb/Zbs instruction
+    bool exec_fp(uint32_t inst);  // False if it trapped
+
+    // Fold the host FP exception flags raised since the CPU started
+    // executing into fflags (see fpu.hpp)
+    void sync_fflags();
 
     void illegal_instruction(uint32_t inst);
 };
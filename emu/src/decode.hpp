@@ -1,30 +1,31 @@
 #pragma once
+#include <array>
 #include <cstdint>
 
 namespace cosmo {
 
-// RISC-V RV32IMAC Instruction Decoder
+// RISC-V RV32IMAFC Instruction Decoder
 //
 // Opcode types from opcode[6:0] field
 // Reference: RISC-V Unprivileged ISA Specification
 enum class OpType {
     LOAD      = 0b0000011,  // I-type: LB, LH, LW, LBU, LHU
-    LOAD_FP   = 0b0000111,  // I-type: FLW, FLD (not implemented)
+    LOAD_FP   = 0b0000111,  // I-type: FLW (RV32F)
     MISC_MEM  = 0b0001111,  // I-type: FENCE, FENCE.I
     OP_IMM    = 0b0010011,  // I-type: ADDI, SLTI, ANDI, ORI, XORI, SLLI, SRLI, SRAI
     AUIPC     = 0b0010111,  // U-type: Add upper immediate to PC
     OP_IMM_32 = 0b0011011,  // RV64 only (not implemented)
     STORE     = 0b0100011,  // S-type: SB, SH, SW
-    STORE_FP  = 0b0100111,  // S-type: FSW, FSD (not implemented)
+    STORE_FP  = 0b0100111,  // S-type: FSW (RV32F)
     AMO       = 0b0101111,  // R-type: LR.W, SC.W, AMO* (RV32A extension)
     OP        = 0b0110011,  // R-type: ADD, SUB, AND, OR, XOR, SLT, SLL, SRL, SRA + RV32M
     LUI       = 0b0110111,  // U-type: Load upper immediate
     OP_32     = 0b0111011,  // RV64 only (not implemented)
-    MADD      = 0b1000011,  // FP multiply-add (not implemented)
-    MSUB      = 0b1000111,  // FP multiply-sub (not implemented)
-    NMSUB     = 0b1001011,  // FP neg multiply-sub (not implemented)
-    NMADD     = 0b1001111,  // FP neg multiply-add (not implemented)
-    OP_FP     = 0b1010011,  // FP operations (not implemented)
+    MADD      = 0b1000011,  // R4-type: FMADD.S
+    MSUB      = 0b1000111,  // R4-type: FMSUB.S
+    NMSUB     = 0b1001011,  // R4-type: FNMSUB.S
+    NMADD     = 0b1001111,  // R4-type: FNMADD.S
+    OP_FP     = 0b1010011,  // R-type: FP arithmetic, compares, conversions, moves
     BRANCH    = 0b1100011,  // B-type: BEQ, BNE, BLT, BGE, BLTU, BGEU
     JALR      = 0b1100111,  // I-type: Jump and link register
     JAL       = 0b1101111,  // J-type: Jump and link
@@ -57,6 +58,9 @@ inline uint32_t funct7(uint32_t inst) { return (inst >> 25) & 0x7F; }
 // funct5[31:27] - AMO operation selector
 inline uint32_t funct5(uint32_t inst) { return (inst >> 27) & 0x1F; }
 
+// rs3[31:27] - source register 3 (R4-type, fused multiply-add)
+inline uint32_t rs3(uint32_t inst)    { return (inst >> 27) & 0x1F; }
+
 // ============================================================================
 // Immediate extraction (sign-extended to 32 bits)
 // ============================================================================
@@ -106,22 +110,24 @@ inline uint32_t csr_addr(uint32_t inst) { return (inst >> 20) & 0xFFF; }
 
 // Check if instruction is compressed (16-bit)
 // Compressed instructions have bits [1:0] != 0b11
-inline bool is_compressed(uint32_t inst) {
+constexpr bool is_compressed(uint32_t inst) {
     return (inst & 0x3) != 0x3;
 }
 
 // Expand 16-bit compressed instruction to 32-bit equivalent
 // Returns 0 on illegal/unimplemented instruction
+// (builds compressed_table below, use expand_compressed)
 //
 // Compressed instruction format:
-//   Quadrant 0 (op=00): C.ADDI4SPN, C.LW, C.SW
+//   Quadrant 0 (op=00): C.ADDI4SPN, C.LW, C.FLW, C.SW, C.FSW
 //   Quadrant 1 (op=01): C.NOP, C.ADDI, C.JAL, C.LI, C.ADDI16SP, C.LUI,
 //                       C.SRLI, C.SRAI, C.ANDI, C.SUB, C.XOR, C.OR, C.AND,
 //                       C.J, C.BEQZ, C.BNEZ
-//   Quadrant 2 (op=10): C.SLLI, C.LWSP, C.JR, C.MV, C.EBREAK, C.JALR, C.ADD, C.SWSP
+//   Quadrant 2 (op=10): C.SLLI, C.LWSP, C.FLWSP, C.JR, C.MV, C.EBREAK, C.JALR,
+//                       C.ADD, C.SWSP, C.FSWSP
 //
 // Reference: RISC-V "C" Standard Extension for Compressed Instructions
-inline uint32_t expand_compressed(uint16_t cinst) {
+constexpr uint32_t expand_compressed_slow(uint16_t cinst) {
     uint32_t op = cinst & 0x3;           // Quadrant selector
     uint32_t funct3 = (cinst >> 13) & 0x7;
 
@@ -142,21 +148,25 @@ inline uint32_t expand_compressed(uint16_t cinst) {
             if (nzuimm == 0) return 0; // Reserved encoding
             return 0x13 | (creg(rd_c) << 7) | (2 << 15) | (nzuimm << 20);
         }
-        case 0b010: { // C.LW: lw rd', offset(rs1')
+        case 0b010:   // C.LW: lw rd', offset(rs1')
+        case 0b011: { // C.FLW: flw rd', offset(rs1') (RV32 only)
             // Load word from memory, base+offset addressing
             uint32_t rd_c = (cinst >> 2) & 0x7;
             uint32_t rs1_c = (cinst >> 7) & 0x7;
             uint32_t uimm = ((cinst >> 7) & 0x38) | ((cinst >> 4) & 0x4) | ((cinst << 1) & 0x40);
-            return 0x03 | (creg(rd_c) << 7) | (0b010 << 12) | (creg(rs1_c) << 15) | (uimm << 20);
+            uint32_t opc = funct3 == 0b011 ? 0x07 : 0x03;
+            return opc | (creg(rd_c) << 7) | (0b010 << 12) | (creg(rs1_c) << 15) | (uimm << 20);
         }
-        case 0b110: { // C.SW: sw rs2', offset(rs1')
+        case 0b110:   // C.SW: sw rs2', offset(rs1')
+        case 0b111: { // C.FSW: fsw rs2', offset(rs1') (RV32 only)
             // Store word to memory, base+offset addressing
             uint32_t rs2_c = (cinst >> 2) & 0x7;
             uint32_t rs1_c = (cinst >> 7) & 0x7;
             uint32_t uimm = ((cinst >> 7) & 0x38) | ((cinst >> 4) & 0x4) | ((cinst << 1) & 0x40);
             uint32_t imm_lo = uimm & 0x1F;
             uint32_t imm_hi = (uimm >> 5) & 0x7F;
-            return 0x23 | (imm_lo << 7) | (0b010 << 12) | (creg(rs1_c) << 15) | (creg(rs2_c) << 20) | (imm_hi << 25);
+            uint32_t opc = funct3 == 0b111 ? 0x27 : 0x23;
+            return opc | (imm_lo << 7) | (0b010 << 12) | (creg(rs1_c) << 15) | (creg(rs2_c) << 20) | (imm_hi << 25);
         }
         default: return 0;
         }
@@ -321,6 +331,11 @@ inline uint32_t expand_compressed(uint16_t cinst) {
             uint32_t uimm = ((cinst >> 2) & 0x1C) | ((cinst >> 7) & 0x20) | ((cinst << 4) & 0xC0);
             return 0x03 | (rd << 7) | (0b010 << 12) | (2 << 15) | (uimm << 20);
         }
+        case 0b011: { // C.FLWSP: flw rd, offset(sp) (RV32 only, any rd)
+            uint32_t rd = (cinst >> 7) & 0x1F;
+            uint32_t uimm = ((cinst >> 2) & 0x1C) | ((cinst >> 7) & 0x20) | ((cinst << 4) & 0xC0);
+            return 0x07 | (rd << 7) | (0b010 << 12) | (2 << 15) | (uimm << 20);
+        }
         case 0b100: { // C.JR, C.MV, C.EBREAK, C.JALR, C.ADD
             uint32_t rs1 = (cinst >> 7) & 0x1F;
             uint32_t rs2 = (cinst >> 2) & 0x1F;
@@ -343,13 +358,15 @@ inline uint32_t expand_compressed(uint16_t cinst) {
                 }
             }
         }
-        case 0b110: { // C.SWSP: sw rs2, offset(sp)
+        case 0b110:   // C.SWSP: sw rs2, offset(sp)
+        case 0b111: { // C.FSWSP: fsw rs2, offset(sp) (RV32 only)
             // Store word to stack (sp-relative)
             uint32_t rs2 = (cinst >> 2) & 0x1F;
             uint32_t uimm = ((cinst >> 7) & 0x3C) | ((cinst >> 1) & 0xC0);
             uint32_t imm_lo = uimm & 0x1F;
             uint32_t imm_hi = (uimm >> 5) & 0x7F;
-            return 0x23 | (imm_lo << 7) | (0b010 << 12) | (2 << 15) | (rs2 << 20) | (imm_hi << 25);
+            uint32_t opc = funct3 == 0b111 ? 0x27 : 0x23;
+            return opc | (imm_lo << 7) | (0b010 << 12) | (2 << 15) | (rs2 << 20) | (imm_hi << 25);
         }
         default: return 0;
         }
@@ -359,4 +376,263 @@ inline uint32_t expand_compressed(uint16_t cinst) {
     }
 }
 
+// Every 16-bit encoding expanded ahead of time (0 for illegal ones and for
+// the 32-bit quadrant), so expansion on fetch is a single load. Built at
+// compile time where the compiler's constexpr limits allow, otherwise
+// during static initialisation.
+struct CompressedTable {
+    std::array<uint32_t, 65536> inst{};
+
+    constexpr CompressedTable() {
+        for (uint32_t c = 0; c < inst.size(); c++) {
+            if (is_compressed(c)) inst[c] = expand_compressed_slow(static_cast<uint16_t>(c));
+        }
+    }
+};
+
+inline const CompressedTable compressed_table{};
+
+inline uint32_t expand_compressed(uint16_t cinst) {
+    return compressed_table.inst[cinst];
+}
+
+// ============================================================================
+// Predecoded instructions (used by the basic-block cache in CPU::run)
+// ============================================================================
+
+// Micro-op selector: one entry per distinct handler in the fast loop, so the
+// dispatch switch needs no nested funct3/funct7 decoding.
+enum class Uop : uint8_t {
+    NOP,                                        // FENCE, ALU ops with rd=x0
+    ADD, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND,
+    MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU,
+    ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI,
+    // Zba/Zbb/Zbs (only decoded with bitmanip enabled)
+    SH1ADD, SH2ADD, SH3ADD,
+    ANDN, ORN, XNOR, MIN, MINU, MAX, MAXU, ROL, ROR, RORI,
+    CLZ, CTZ, CPOP, SEXTB, SEXTH, ZEXTH, ORCB, REV8,
+    BCLR, BEXT, BINV, BSET, BCLRI, BEXTI, BINVI, BSETI,  // Immediate forms: imm = bit
+    LB, LH, LW, LBU, LHU,
+    SB, SH, SW,
+    LUI, AUIPC,
+    FLW, FSW,                                   // RV32F
+    FADD, FSUB, FMUL, FDIV,                     // imm = rm
+    FMADD, FMSUB, FNMSUB, FNMADD,               // imm = rm | rs3 << 3
+    FP,                                         // Other OP_FP, executed via exec_fp()
+    // Everything from here on ends a basic block
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    JAL, JALR,
+    SYSTEM,                                     // Executed via exec_system()
+    AMO,                                        // Executed via exec_amo()
+    ILLEGAL,
+};
+
+// Instruction with operands and sign-extended immediate already extracted
+struct DecodedInst {
+    Uop op;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;      // I/S/B/U/J immediate depending on op (shamt for shifts)
+    uint32_t inst;    // Expanded 32-bit encoding (for SYSTEM/AMO/ILLEGAL)
+    uint8_t len;      // 2 = compressed, 4 = full-size
+};
+
+// Instructions after which a basic block must end (control flow or
+// state that the fast loop cannot track: traps, CSRs, WFI, MRET)
+inline bool ends_block(Uop op) {
+    return op >= Uop::BEQ;
+}
+
+// Zba/Zbb/Zbs encodings in OP and OP_IMM, Uop::ILLEGAL for anything else
+inline Uop decode_bitmanip(uint32_t inst) {
+    uint32_t f3 = funct3(inst);
+    uint32_t f7 = funct7(inst);
+    uint32_t r2 = rs2(inst);
+
+    if (opcode(inst) == static_cast<uint32_t>(OpType::OP)) {
+        switch (f7 << 3 | f3) {
+            case 0x10 << 3 | 2: return Uop::SH1ADD;
+            case 0x10 << 3 | 4: return Uop::SH2ADD;
+            case 0x10 << 3 | 6: return Uop::SH3ADD;
+            case 0x20 << 3 | 7: return Uop::ANDN;
+            case 0x20 << 3 | 6: return Uop::ORN;
+            case 0x20 << 3 | 4: return Uop::XNOR;
+            case 0x05 << 3 | 4: return Uop::MIN;
+            case 0x05 << 3 | 5: return Uop::MINU;
+            case 0x05 << 3 | 6: return Uop::MAX;
+            case 0x05 << 3 | 7: return Uop::MAXU;
+            case 0x30 << 3 | 1: return Uop::ROL;
+            case 0x30 << 3 | 5: return Uop::ROR;
+            case 0x24 << 3 | 1: return Uop::BCLR;
+            case 0x24 << 3 | 5: return Uop::BEXT;
+            case 0x34 << 3 | 1: return Uop::BINV;
+            case 0x14 << 3 | 1: return Uop::BSET;
+            case 0x04 << 3 | 4: return r2 == 0 ? Uop::ZEXTH : Uop::ILLEGAL;
+        }
+        return Uop::ILLEGAL;
+    }
+
+    if (opcode(inst) == static_cast<uint32_t>(OpType::OP_IMM)) {
+        if (f3 == 1) {
+            switch (f7) {
+                case 0x30:
+                    switch (r2) {
+                        case 0: return Uop::CLZ;
+                        case 1: return Uop::CTZ;
+                        case 2: return Uop::CPOP;
+                        case 4: return Uop::SEXTB;
+                        case 5: return Uop::SEXTH;
+                    }
+                    return Uop::ILLEGAL;
+                case 0x24: return Uop::BCLRI;
+                case 0x34: return Uop::BINVI;
+                case 0x14: return Uop::BSETI;
+            }
+        } else if (f3 == 5) {
+            switch (inst >> 20) {
+                case 0x287: return Uop::ORCB;
+                case 0x698: return Uop::REV8;
+            }
+            switch (f7) {
+                case 0x30: return Uop::RORI;
+                case 0x24: return Uop::BEXTI;
+            }
+        }
+    }
+    return Uop::ILLEGAL;
+}
+
+// funct7 of an OP or OP_IMM shift instruction is one RV32IM defines.
+// Everything else there is Zba/Zbb/Zbs or unused.
+inline bool base_funct7(uint32_t inst) {
+    uint32_t f3 = funct3(inst);
+    uint32_t f7 = funct7(inst);
+    if (f7 == 0x01) return opcode(inst) == static_cast<uint32_t>(OpType::OP);  // RV32M
+    return f7 == 0x00 || (f7 == 0x20 && (f3 == 0 || f3 == 5));  // SUB, SRA(I)
+}
+
+// Predecode an (already expanded) 32-bit instruction
+// inst == 0 marks an illegal compressed encoding
+// bitmanip: also decode Zba/Zbb/Zbs (otherwise they are ILLEGAL, as on the
+// CH32V307)
+inline DecodedInst predecode(uint32_t inst, uint32_t len, bool bitmanip = false) {
+    DecodedInst di{Uop::ILLEGAL, static_cast<uint8_t>(rd(inst)),
+                   static_cast<uint8_t>(rs1(inst)), static_cast<uint8_t>(rs2(inst)),
+                   0, inst, static_cast<uint8_t>(len)};
+    uint32_t f3 = funct3(inst);
+    uint32_t f7 = funct7(inst);
+
+    if (bitmanip) {
+        Uop op = decode_bitmanip(inst);
+        if (op != Uop::ILLEGAL) {
+            di.op = di.rd ? op : Uop::NOP;
+            di.imm = static_cast<int32_t>(di.rs2);  // Shift amount / bit index
+            return di;
+        }
+    }
+
+    switch (static_cast<OpType>(opcode(inst))) {
+    case OpType::OP:
+        if (!base_funct7(inst)) break;
+        if (f7 == 0x01) {
+            static constexpr Uop m_ops[8] = {Uop::MUL, Uop::MULH, Uop::MULHSU, Uop::MULHU,
+                                             Uop::DIV, Uop::DIVU, Uop::REM, Uop::REMU};
+            di.op = m_ops[f3];
+        } else {
+            static constexpr Uop ops[8] = {Uop::ADD, Uop::SLL, Uop::SLT, Uop::SLTU,
+                                           Uop::XOR, Uop::SRL, Uop::OR, Uop::AND};
+            di.op = ops[f3];
+            if (f7 == 0x20) di.op = f3 == 0 ? Uop::SUB : Uop::SRA;
+        }
+        if (di.rd == 0) di.op = Uop::NOP;
+        break;
+
+    case OpType::OP_IMM: {
+        static constexpr Uop ops[8] = {Uop::ADDI, Uop::SLLI, Uop::SLTI, Uop::SLTIU,
+                                       Uop::XORI, Uop::SRLI, Uop::ORI, Uop::ANDI};
+        di.op = ops[f3];
+        di.imm = imm_i(inst);
+        if (f3 == 1 || f3 == 5) {
+            if (!base_funct7(inst)) {
+                di.op = Uop::ILLEGAL;
+                break;
+            }
+            if (f3 == 5 && (inst & (1 << 30))) di.op = Uop::SRAI;
+            di.imm &= 0x1F;
+        }
+        if (di.rd == 0) di.op = Uop::NOP;
+        break;
+    }
+
+    case OpType::LOAD: {
+        static constexpr Uop ops[8] = {Uop::LB, Uop::LH, Uop::LW, Uop::ILLEGAL,
+                                       Uop::LBU, Uop::LHU, Uop::ILLEGAL, Uop::ILLEGAL};
+        di.op = ops[f3];
+        di.imm = imm_i(inst);
+        break;
+    }
+
+    case OpType::STORE: {
+        static constexpr Uop ops[8] = {Uop::SB, Uop::SH, Uop::SW, Uop::ILLEGAL,
+                                       Uop::ILLEGAL, Uop::ILLEGAL, Uop::ILLEGAL, Uop::ILLEGAL};
+        di.op = ops[f3];
+        di.imm = imm_s(inst);
+        break;
+    }
+
+    case OpType::BRANCH: {
+        static constexpr Uop ops[8] = {Uop::BEQ, Uop::BNE, Uop::ILLEGAL, Uop::ILLEGAL,
+                                       Uop::BLT, Uop::BGE, Uop::BLTU, Uop::BGEU};
+        di.op = ops[f3];
+        di.imm = imm_b(inst);
+        break;
+    }
+
+    case OpType::JAL:      di.op = Uop::JAL;    di.imm = imm_j(inst); break;
+    case OpType::JALR:     di.op = Uop::JALR;   di.imm = imm_i(inst); break;
+    case OpType::LUI:      di.op = di.rd ? Uop::LUI : Uop::NOP;   di.imm = imm_u(inst); break;
+    case OpType::AUIPC:    di.op = di.rd ? Uop::AUIPC : Uop::NOP; di.imm = imm_u(inst); break;
+    case OpType::LOAD_FP:
+        if (f3 == 2) di.op = Uop::FLW;
+        di.imm = imm_i(inst);
+        break;
+
+    case OpType::STORE_FP:
+        if (f3 == 2) di.op = Uop::FSW;
+        di.imm = imm_s(inst);
+        break;
+
+    case OpType::MADD:
+    case OpType::MSUB:
+    case OpType::NMSUB:
+    case OpType::NMADD:
+        if ((f7 & 0x3) == 0) {  // fmt = S
+            static constexpr Uop ops[4] = {Uop::FMADD, Uop::FMSUB, Uop::FNMSUB, Uop::FNMADD};
+            di.op = ops[(opcode(inst) >> 2) & 0x3];
+            di.imm = static_cast<int32_t>(f3 | rs3(inst) << 3);
+        }
+        break;
+
+    case OpType::OP_FP:
+        switch (f7) {
+            case 0x00: di.op = Uop::FADD; break;
+            case 0x04: di.op = Uop::FSUB; break;
+            case 0x08: di.op = Uop::FMUL; break;
+            case 0x0C: di.op = Uop::FDIV; break;
+            default:   di.op = Uop::FP;   break;
+        }
+        di.imm = static_cast<int32_t>(f3);
+        break;
+
+    case OpType::SYSTEM:   di.op = Uop::SYSTEM; break;
+    case OpType::AMO:      di.op = Uop::AMO;    break;
+    case OpType::MISC_MEM: di.op = Uop::NOP;    break;
+    default: break;
+    }
+
+    if (inst == 0) di.op = Uop::ILLEGAL;
+    return di;
+}
+
 } // namespace cosmo
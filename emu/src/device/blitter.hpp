@@ -0,0 +1,278 @@
+// 2D Blitter
+// Rectangle fill, overlapping copy and 1bpp color expansion on 4bpp
+// (display mode 0 layout, low nibble first) or RGB565 surfaces
+//
+// A surface is a base address and a pitch in bytes; rectangles are given
+// in pixels. Surfaces can be anywhere in host memory (flash, SRAM, FSMC).
+// Writing CMD with a nonzero OP latches all registers and starts the
+// operation; it is carried out in one go once its cycle cost has passed,
+// when BUSY clears, DONE is set and the completion IRQ fires if enabled.
+// A CMD written while BUSY is ignored.
+//
+// Cost: SETUP_CYCLES per operation, ROW_CYCLES per row and one cycle per
+// 16-bit FSMC halfword written (two for COPY, which also reads).
+
+#pragma once
+
+#include "../bus.hpp"
+#include "../scheduler.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace cosmo {
+
+// Blitter register offsets
+namespace BlitReg {
+    constexpr uint32_t CMD       = 0x00;  // Operation and flags, starts it (rw)
+    constexpr uint32_t STATUS    = 0x04;  // Status (BUSY ro, DONE/ERR w1c)
+    constexpr uint32_t DST       = 0x08;  // Destination surface address
+    constexpr uint32_t DST_PITCH = 0x0C;  // Destination bytes per row
+    constexpr uint32_t SRC       = 0x10;  // Source surface / bitmap address
+    constexpr uint32_t SRC_PITCH = 0x14;  // Source bytes per row
+    constexpr uint32_t DST_XY    = 0x18;  // Destination x (15:0), y (31:16)
+    constexpr uint32_t SRC_XY    = 0x1C;  // Source x (15:0), y (31:16)
+    constexpr uint32_t SIZE      = 0x20;  // Width (15:0), height (31:16)
+    constexpr uint32_t COLOR     = 0x24;  // Foreground (15:0), background (31:16)
+}
+
+// CMD bits
+namespace BlitCmd {
+    constexpr uint32_t OP_MASK = 3 << 0;
+    constexpr uint32_t FILL    = 1;       // Fill with the foreground color
+    constexpr uint32_t COPY    = 2;       // Copy, any overlap
+    constexpr uint32_t EXPAND  = 3;       // 1bpp source (MSB first) to fg/bg
+    constexpr uint32_t IE      = 1 << 4;  // Completion interrupt enable
+    constexpr uint32_t FMT16   = 1 << 5;  // RGB565 surfaces (else 4bpp)
+    constexpr uint32_t TRANSP  = 1 << 6;  // EXPAND: leave 0 bits untouched
+}
+
+// STATUS bits
+namespace BlitStatus {
+    constexpr uint32_t BUSY = 1 << 0;  // Operation in progress
+    constexpr uint32_t DONE = 1 << 1;  // Operation finished
+    constexpr uint32_t ERR  = 1 << 2;  // A row was outside host memory
+}
+
+// Blitter IRQ number
+constexpr uint32_t BLIT_IRQ = 27;
+
+class Blitter : public Device {
+public:
+    static constexpr uint64_t SETUP_CYCLES = 8;
+    static constexpr uint64_t ROW_CYCLES = 2;
+
+    // Host memory behind a guest range (Bus::memory_span semantics)
+    using BusSpanFn = std::function<uint8_t*(uint32_t addr, uint32_t len, bool write)>;
+
+    void set_bus_callbacks(BusSpanFn span) { bus_span_ = std::move(span); }
+
+    void set_event_slot(EventSlot slot) { event_ = slot; }
+
+    uint32_t read(uint32_t addr, Width w) override {
+        addr &= 0xFF;
+        sync(event_.now());
+
+        switch (addr) {
+            case BlitReg::CMD:       return regs_.cmd;
+            case BlitReg::STATUS:    return status_ | (busy_ ? BlitStatus::BUSY : 0);
+            case BlitReg::DST:       return regs_.dst;
+            case BlitReg::DST_PITCH: return regs_.dst_pitch;
+            case BlitReg::SRC:       return regs_.src;
+            case BlitReg::SRC_PITCH: return regs_.src_pitch;
+            case BlitReg::DST_XY:    return regs_.dst_xy;
+            case BlitReg::SRC_XY:    return regs_.src_xy;
+            case BlitReg::SIZE:      return regs_.size;
+            case BlitReg::COLOR:     return regs_.color;
+        }
+        return 0;
+    }
+
+    void write(uint32_t addr, Width w, uint32_t val) override {
+        addr &= 0xFF;
+        uint64_t now = event_.now();
+        sync(now);
+
+        switch (addr) {
+            case BlitReg::CMD:
+                regs_.cmd = val;
+                if ((val & BlitCmd::OP_MASK) && !busy_) start(now);
+                break;
+            case BlitReg::STATUS:
+                status_ &= ~(val & (BlitStatus::DONE | BlitStatus::ERR));
+                break;
+            case BlitReg::DST:       regs_.dst = val; break;
+            case BlitReg::DST_PITCH: regs_.dst_pitch = val; break;
+            case BlitReg::SRC:       regs_.src = val; break;
+            case BlitReg::SRC_PITCH: regs_.src_pitch = val; break;
+            case BlitReg::DST_XY:    regs_.dst_xy = val; break;
+            case BlitReg::SRC_XY:    regs_.src_xy = val; break;
+            case BlitReg::SIZE:      regs_.size = val; break;
+            case BlitReg::COLOR:     regs_.color = val; break;
+        }
+    }
+
+    // Completion event: carry out the operation and deliver its interrupt
+    std::optional<Interrupt> tick(uint64_t cycles) override {
+        sync(cycles);
+        if (!irq_pending_) return std::nullopt;
+        irq_pending_ = false;
+        return Interrupt{BLIT_IRQ};
+    }
+
+private:
+    struct Regs {
+        uint32_t cmd = 0;
+        uint32_t dst = 0, dst_pitch = 0;
+        uint32_t src = 0, src_pitch = 0;
+        uint32_t dst_xy = 0, src_xy = 0;
+        uint32_t size = 0;
+        uint32_t color = 0;
+    };
+
+    Regs regs_;     // As last written
+    Regs op_;       // Latched at start
+    uint32_t status_ = 0;
+    bool busy_ = false;
+    bool irq_pending_ = false;
+    uint64_t done_at_ = 0;
+    BusSpanFn bus_span_;
+    EventSlot event_;
+    std::vector<uint16_t> row_;  // COPY source row
+
+    static uint32_t lo(uint32_t v) { return v & 0xFFFF; }
+    static uint32_t hi(uint32_t v) { return v >> 16; }
+
+    void start(uint64_t now) {
+        op_ = regs_;
+        busy_ = true;
+        status_ &= ~BlitStatus::DONE;
+
+        uint32_t op = op_.cmd & BlitCmd::OP_MASK;
+        uint64_t w = lo(op_.size), h = hi(op_.size);
+        uint64_t x = lo(op_.dst_xy);
+        uint64_t halfwords = (op_.cmd & BlitCmd::FMT16) ? w : (x % 4 + w + 3) / 4;
+        uint64_t per_row = ROW_CYCLES + halfwords * (op == BlitCmd::COPY ? 2 : 1);
+        done_at_ = now + SETUP_CYCLES + (w ? h * per_row : 0);
+        event_.schedule(done_at_);
+    }
+
+    // Finish the operation in flight once its time has come
+    void sync(uint64_t now) {
+        if (!busy_ || now < done_at_) return;
+        busy_ = false;
+        execute();
+        status_ |= BlitStatus::DONE;
+        if (op_.cmd & BlitCmd::IE) {
+            irq_pending_ = true;
+            event_.schedule(now);
+        }
+    }
+
+    // Pixel access on one row of a surface
+    static uint32_t get(const uint8_t* row, uint32_t x, bool fmt16) {
+        if (fmt16) {
+            uint16_t v;
+            std::memcpy(&v, row + x * 2, 2);
+            return v;
+        }
+        return (row[x / 2] >> (x % 2 * 4)) & 0xF;
+    }
+
+    static void put(uint8_t* row, uint32_t x, uint32_t c, bool fmt16) {
+        if (fmt16) {
+            uint16_t v = static_cast<uint16_t>(c);
+            std::memcpy(row + x * 2, &v, 2);
+            return;
+        }
+        uint8_t& b = row[x / 2];
+        b = (x % 2) ? (b & 0x0F) | ((c & 0xF) << 4) : (b & 0xF0) | (c & 0xF);
+    }
+
+    // Host memory of row y of a rectangle starting at pixel x, w pixels
+    // wide, from the byte holding pixel x (see first_pixel)
+    uint8_t* span(uint32_t base, uint32_t pitch, uint32_t x, uint32_t y, uint32_t w,
+                  bool fmt16, bool write) {
+        uint32_t first = fmt16 ? x * 2 : x / 2;
+        uint32_t end = fmt16 ? (x + w) * 2 : (x + w + 1) / 2;
+        return bus_span_ ? bus_span_(base + y * pitch + first, end - first, write) : nullptr;
+    }
+
+    // Index of pixel x in its span
+    static uint32_t first_pixel(uint32_t x, bool fmt16) { return fmt16 ? 0 : x % 2; }
+
+    void execute() {
+        bool fmt16 = op_.cmd & BlitCmd::FMT16;
+        uint32_t w = lo(op_.size), h = hi(op_.size);
+        uint32_t dx = lo(op_.dst_xy), dy = hi(op_.dst_xy);
+        uint32_t sx = lo(op_.src_xy), sy = hi(op_.src_xy);
+        uint32_t fg = lo(op_.color), bg = hi(op_.color);
+        if (w == 0) return;
+
+        switch (op_.cmd & BlitCmd::OP_MASK) {
+            case BlitCmd::FILL:
+                for (uint32_t y = 0; y < h; y++) {
+                    uint8_t* d = span(op_.dst, op_.dst_pitch, dx, dy + y, w, fmt16, true);
+                    if (!d) return fail();
+                    fill_row(d, first_pixel(dx, fmt16), w, fg, fmt16);
+                }
+                break;
+
+            case BlitCmd::COPY: {
+                // Rows bottom-up when the destination lies further on, each
+                // row through a buffer, so any overlap copies correctly
+                bool up = static_cast<uint64_t>(op_.dst) + dy * op_.dst_pitch >
+                          static_cast<uint64_t>(op_.src) + sy * op_.src_pitch;
+                row_.resize(w);
+                for (uint32_t i = 0; i < h; i++) {
+                    uint32_t y = up ? h - 1 - i : i;
+                    const uint8_t* s = span(op_.src, op_.src_pitch, sx, sy + y, w, fmt16, false);
+                    uint8_t* d = s ? span(op_.dst, op_.dst_pitch, dx, dy + y, w, fmt16, true) : nullptr;
+                    if (!d) return fail();
+                    if (fmt16 || (sx % 2 == 0 && dx % 2 == 0 && w % 2 == 0)) {
+                        std::memmove(d, s, fmt16 ? w * 2 : w / 2);
+                        continue;
+                    }
+                    for (uint32_t x = 0; x < w; x++) row_[x] = get(s, sx % 2 + x, false);
+                    for (uint32_t x = 0; x < w; x++) put(d, dx % 2 + x, row_[x], false);
+                }
+                break;
+            }
+
+            case BlitCmd::EXPAND: {
+                bool transp = op_.cmd & BlitCmd::TRANSP;
+                uint32_t bytes = (sx % 8 + w + 7) / 8;
+                for (uint32_t y = 0; y < h; y++) {
+                    const uint8_t* s = bus_span_ ? bus_span_(op_.src + (sy + y) * op_.src_pitch + sx / 8,
+                                                             bytes, false) : nullptr;
+                    uint8_t* d = s ? span(op_.dst, op_.dst_pitch, dx, dy + y, w, fmt16, true) : nullptr;
+                    if (!d) return fail();
+                    for (uint32_t x = 0; x < w; x++) {
+                        uint32_t bit = sx % 8 + x;
+                        bool set = (s[bit / 8] << (bit % 8)) & 0x80;
+                        if (set || !transp) put(d, first_pixel(dx, fmt16) + x, set ? fg : bg, fmt16);
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    static void fill_row(uint8_t* row, uint32_t x, uint32_t w, uint32_t c, bool fmt16) {
+        if (fmt16) {
+            for (uint32_t i = 0; i < w; i++) put(row, x + i, c, true);
+            return;
+        }
+        // Odd ends by nibble, whole bytes in between
+        uint32_t end = x + w;
+        if (x % 2) put(row, x++, c, false);
+        if (end % 2 && x < end) put(row, --end, c, false);
+        if (x < end) std::memset(row + x / 2, (c & 0xF) * 0x11, (end - x) / 2);
+    }
+
+    void fail() { status_ |= BlitStatus::ERR; }
+};
+
+} // namespace cosmo
@@ -1,9 +1,13 @@
 // Display Control Peripheral
-// Mode selection, VBlank status, Palette
+// Mode selection, VBlank status and IRQ, Palette, scroll offset, framebuffer
+// base and VBlank-latched page flipping
 
 #pragma once
 
 #include "../bus.hpp"
+#include "../scheduler.hpp"
+#include "fsmc.hpp"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
@@ -19,12 +23,22 @@ enum class DisplayMode : uint32_t {
 namespace DisplayReg {
     constexpr uint32_t MODE    = 0x00;  // Display mode (rw)
     constexpr uint32_t STATUS  = 0x04;  // Status register (ro)
+    constexpr uint32_t SCROLL  = 0x08;  // Vertical scroll in scanlines (rw)
+    constexpr uint32_t FBBASE  = 0x0C;  // Framebuffer offset in FSMC SRAM (rw)
+    constexpr uint32_t CTRL    = 0x10;  // Control register (rw)
+    constexpr uint32_t FLIP    = 0x14;  // Next FBBASE, taken at VBlank start (rw)
     constexpr uint32_t PALETTE = 0x40;  // Palette base (16 x 16-bit RGB565)
 }
 
 // Status bits
 namespace DisplayStatus {
-    constexpr uint32_t VBLANK = 1 << 0;  // VBlank active
+    constexpr uint32_t VBLANK       = 1 << 0;  // VBlank active
+    constexpr uint32_t FLIP_PENDING = 1 << 1;  // FLIP written, not yet taken
+}
+
+// Control bits
+namespace DisplayCtrl {
+    constexpr uint32_t VBLANK_IE = 1 << 0;  // VBlank start interrupt enable
 }
 
 class DisplayControl : public Device {
@@ -34,6 +48,7 @@ public:
     static constexpr int MODE0_HEIGHT = 400;
     static constexpr int MODE1_WIDTH = 320;
     static constexpr int MODE1_HEIGHT = 200;
+    static constexpr uint32_t FRAME_BYTES = MODE0_WIDTH * MODE0_HEIGHT / 2;  // Both modes
 
     // Timing (cycles)
     static constexpr uint64_t CYCLES_PER_FRAME = 144'000'000 / 60;  // 60 Hz
@@ -47,6 +62,11 @@ public:
         }
     }
 
+    void set_event_slot(EventSlot slot) {
+        event_ = slot;
+        reschedule(event_.now());
+    }
+
     uint32_t read(uint32_t addr, Width w) override {
         addr &= 0xFF;
 
@@ -55,7 +75,24 @@ public:
         }
 
         if (addr == DisplayReg::STATUS) {
-            return status_;
+            update_status(event_.now());
+            return status_ | (flip_pending_ ? DisplayStatus::FLIP_PENDING : 0);
+        }
+
+        if (addr == DisplayReg::SCROLL) {
+            return scroll_;
+        }
+
+        if (addr == DisplayReg::FBBASE) {
+            return fb_base_;
+        }
+
+        if (addr == DisplayReg::CTRL) {
+            return vblank_irq_enabled_ ? DisplayCtrl::VBLANK_IE : 0;
+        }
+
+        if (addr == DisplayReg::FLIP) {
+            return flip_pending_ ? flip_base_ : fb_base_;
         }
 
         // Palette access (16 entries, 16-bit each)
@@ -74,36 +111,63 @@ public:
 
         if (addr == DisplayReg::MODE) {
             mode_ = static_cast<DisplayMode>(val & 1);
+            changed_ = true;
             return;
         }
 
         // STATUS is read-only
 
+        if (addr == DisplayReg::SCROLL) {
+            scroll_ = val & 0xFFFF;
+            changed_ = true;
+            return;
+        }
+
+        if (addr == DisplayReg::FBBASE) {
+            fb_base_ = clamp_base(val);
+            changed_ = true;
+            return;
+        }
+
+        if (addr == DisplayReg::CTRL) {
+            enable_vblank_irq(val & DisplayCtrl::VBLANK_IE);
+            return;
+        }
+
+        // The page being shown is left alone until VBlank, so the guest can
+        // wait for FLIP_PENDING to clear before drawing into it again
+        if (addr == DisplayReg::FLIP) {
+            flip_base_ = clamp_base(val);
+            flip_pending_ = true;
+            reschedule(event_.now());
+            return;
+        }
+
         // Palette access
         if (addr >= DisplayReg::PALETTE && addr < DisplayReg::PALETTE + 32) {
             uint32_t idx = (addr - DisplayReg::PALETTE) / 2;
             if (idx < 16) {
                 palette_[idx] = val & 0xFFFF;
+                changed_ = true;
             }
         }
     }
 
-    // Update VBlank status based on cycle count
+    // VBlank start event (only scheduled while the VBlank IRQ is enabled or
+    // a flip is pending; STATUS is computed from the cycle count on read)
     std::optional<Interrupt> tick(uint64_t cycles) override {
-        uint64_t frame_cycle = cycles % CYCLES_PER_FRAME;
-        uint64_t active_end = CYCLES_PER_FRAME - VBLANK_CYCLES;
+        bool is_vblank = update_status(cycles);
 
-        bool was_vblank = (status_ & DisplayStatus::VBLANK) != 0;
-        bool is_vblank = frame_cycle >= active_end;
-
-        if (is_vblank) {
-            status_ |= DisplayStatus::VBLANK;
-        } else {
-            status_ &= ~DisplayStatus::VBLANK;
+        if (is_vblank && flip_pending_) {
+            fb_base_ = flip_base_;
+            flip_pending_ = false;
+            changed_ = true;
         }
+        reschedule(cycles);
 
-        // Generate interrupt on VBlank start
-        if (!was_vblank && is_vblank && vblank_irq_enabled_) {
+        // Generate interrupt on VBlank start (the other event is the re-arm
+        // at the start of the active period)
+        if (is_vblank && vblank_irq_enabled_) {
             return Interrupt{VBLANK_IRQ};
         }
 
@@ -114,6 +178,7 @@ public:
     DisplayMode mode() const { return mode_; }
     bool is_vblank() const { return (status_ & DisplayStatus::VBLANK) != 0; }
     const std::array<uint16_t, 16>& palette() const { return palette_; }
+    uint32_t fb_base() const { return fb_base_; }
 
     // Get current dimensions
     int width() const {
@@ -124,7 +189,24 @@ public:
         return (mode_ == DisplayMode::Mode0_640x400x4bpp) ? MODE0_HEIGHT : MODE1_HEIGHT;
     }
 
-    void enable_vblank_irq(bool enable) { vblank_irq_enabled_ = enable; }
+    // FSMC offset of displayed row y: the frame starts scroll lines down
+    // from fb_base and wraps around to its first line
+    uint32_t row_offset(int y) const {
+        int h = height();
+        return fb_base_ + static_cast<uint32_t>((y + scroll_ % h) % h) * (FRAME_BYTES / h);
+    }
+
+    // Mode, palette, scroll or base changed since the last call
+    bool take_changed() {
+        bool c = changed_;
+        changed_ = false;
+        return c;
+    }
+
+    void enable_vblank_irq(bool enable) {
+        vblank_irq_enabled_ = enable;
+        reschedule(event_.now());
+    }
 
     static constexpr uint32_t VBLANK_IRQ = 24;  // Display VBlank IRQ number
 
@@ -132,7 +214,44 @@ private:
     DisplayMode mode_ = DisplayMode::Mode0_640x400x4bpp;
     uint32_t status_ = 0;
     std::array<uint16_t, 16> palette_{};
+    uint32_t scroll_ = 0;
+    uint32_t fb_base_ = FSMC::FRAMEBUFFER_OFFSET;
+    uint32_t flip_base_ = 0;
+    bool flip_pending_ = false;
     bool vblank_irq_enabled_ = false;
+    bool changed_ = true;
+    EventSlot event_;
+
+    static constexpr uint64_t ACTIVE_CYCLES = CYCLES_PER_FRAME - VBLANK_CYCLES;
+
+    // Word aligned, and the whole frame must fit in the SRAM
+    static uint32_t clamp_base(uint32_t val) {
+        return std::min(val & (FSMC::SIZE - 4), FSMC::SIZE - FRAME_BYTES);
+    }
+
+    // Update VBlank status based on cycle count
+    bool update_status(uint64_t cycles) {
+        bool is_vblank = cycles % CYCLES_PER_FRAME >= ACTIVE_CYCLES;
+        if (is_vblank) {
+            status_ |= DisplayStatus::VBLANK;
+        } else {
+            status_ &= ~DisplayStatus::VBLANK;
+        }
+        return is_vblank;
+    }
+
+    // Next VBlank start (or end, to re-arm the edge) while the IRQ is on or
+    // a flip waits for it
+    void reschedule(uint64_t cycles) {
+        if (!vblank_irq_enabled_ && !flip_pending_) {
+            event_.cancel();
+            return;
+        }
+        uint64_t frame_cycle = cycles % CYCLES_PER_FRAME;
+        uint64_t frame_start = cycles - frame_cycle;
+        event_.schedule(frame_cycle < ACTIVE_CYCLES ? frame_start + ACTIVE_CYCLES
+                                                    : frame_start + CYCLES_PER_FRAME);
+    }
 };
 
 } // namespace cosmo
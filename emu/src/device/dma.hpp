@@ -1,12 +1,25 @@
 // DMA Controller
 // CH32V307-style DMA with 8 channels
+//
+// The controller moves one element per CPU cycle. Each cycle goes to the
+// enabled channel with the highest priority (CCR.PL, then lowest channel
+// number) that has a request: memory-to-memory channels always request,
+// peripheral channels only while one of their request lines is active
+// (channels without connected lines run freely). Transfers are done
+// lazily, up to the current cycle, on every register access and on the
+// DMA's own events, which are posted for the next half-transfer or
+// completion of the channel being served.
 
 #pragma once
 
 #include "../bus.hpp"
+#include "../scheduler.hpp"
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <vector>
 
 namespace cosmo {
 
@@ -64,14 +77,32 @@ public:
     // Callback for bus access (DMA needs to read/write through bus)
     using BusReadFn = std::function<uint32_t(uint32_t addr, Width w)>;
     using BusWriteFn = std::function<void(uint32_t addr, Width w, uint32_t val)>;
+    // Optional: host memory behind a guest range for block copies
+    // (Bus::memory_span semantics)
+    using BusSpanFn = std::function<uint8_t*(uint32_t addr, uint32_t len, bool write)>;
 
-    void set_bus_callbacks(BusReadFn read, BusWriteFn write) {
+    void set_bus_callbacks(BusReadFn read, BusWriteFn write, BusSpanFn span = nullptr) {
         bus_read_ = std::move(read);
         bus_write_ = std::move(write);
+        bus_span_ = std::move(span);
     }
 
+    // Peripheral request line for channel ch (several lines are OR'ed)
+    using RequestFn = std::function<bool()>;
+
+    void connect_request(int ch, RequestFn line) {
+        requests_[ch].push_back(std::move(line));
+    }
+
+    // Called by peripherals when one of their request lines may have
+    // become active
+    void request_changed() { update(event_.now()); }
+
+    void set_event_slot(EventSlot slot) { event_ = slot; }
+
     uint32_t read(uint32_t addr, Width w) override {
         addr &= 0xFFF;
+        update(event_.now());
 
         if (addr == 0x00) return isr_;
         if (addr == 0x04) return 0; // IFCR is write-only
@@ -101,6 +132,8 @@ public:
 
     void write(uint32_t addr, Width w, uint32_t val) override {
         addr &= 0xFFF;
+        uint64_t now = event_.now();
+        update(now);
 
         if (addr == 0x00) return; // ISR is read-only
 
@@ -140,47 +173,23 @@ public:
                 }
             }
         }
+
+        reschedule(now);
     }
 
-    // Tick DMA - called from main loop
-    // Returns IRQ number if interrupt pending, -1 otherwise
+    // DMA event: catch up and deliver one pending channel interrupt (more
+    // pending interrupts get a follow-up event at the same cycle)
     std::optional<Interrupt> tick(uint64_t cycles) override {
-        // Process one transfer per enabled channel per tick
-        // Priority: lower channel number = higher priority
-        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-            auto& chan = channels_[ch];
-
-            if (!(chan.ccr & DMA_CCR::EN)) continue;
-            if (chan.remaining == 0) continue;
-
-            do_transfer(ch);
+        sync(cycles);
 
-            // Check for completion
-            if (chan.remaining == 0) {
-                // Set transfer complete flag
-                isr_ |= (DMA_ISR::TCIF | DMA_ISR::GIF) << (ch * 4);
-
-                if (chan.ccr & DMA_CCR::CIRC) {
-                    // Circular mode: reload
-                    chan.remaining = chan.reload_count;
-                    chan.current_par = chan.cpar;
-                    chan.current_mar = chan.cmar;
-                } else {
-                    // One-shot: disable channel
-                    chan.ccr &= ~DMA_CCR::EN;
-                }
-
-                // Generate interrupt if enabled
-                if (chan.ccr & DMA_CCR::TCIE) {
-                    return Interrupt{static_cast<uint32_t>(DMA1_CH1_IRQ + ch)};
-                }
-            }
-
-            // Only process one channel per tick for fairness
-            break;
+        std::optional<Interrupt> irq;
+        if (irq_pending_) {
+            uint32_t ch = __builtin_ctz(irq_pending_);
+            irq_pending_ &= irq_pending_ - 1;
+            irq = Interrupt{static_cast<uint32_t>(DMA1_CH1_IRQ + ch)};
         }
-
-        return std::nullopt;
+        reschedule(cycles);
+        return irq;
     }
 
     // Check if any channel has pending interrupt
@@ -203,6 +212,116 @@ private:
 
     BusReadFn bus_read_;
     BusWriteFn bus_write_;
+    BusSpanFn bus_span_;
+
+    std::array<std::vector<RequestFn>, NUM_CHANNELS> requests_;
+
+    uint64_t last_cycle_ = 0;   // CPU cycle up to which transfers are done
+    bool idle_ = true;          // No channel could run at last_cycle_
+    uint32_t irq_pending_ = 0;  // Channels with an undelivered interrupt
+    EventSlot event_;
+
+    void update(uint64_t now) {
+        sync(now);
+        reschedule(now);
+    }
+
+    static uint32_t priority(const DMAChannel& chan) {
+        return (chan.ccr & DMA_CCR::PL_MASK) >> 12;
+    }
+
+    bool requesting(int ch) const {
+        const auto& chan = channels_[ch];
+        if (!(chan.ccr & DMA_CCR::EN) || chan.remaining == 0) return false;
+        if ((chan.ccr & DMA_CCR::MEM2MEM) || requests_[ch].empty()) return true;
+        for (auto& line : requests_[ch]) {
+            if (line()) return true;
+        }
+        return false;
+    }
+
+    // Channel that gets the next cycle, -1 if none
+    int next_channel() const {
+        int best = -1;
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            if (!requesting(ch)) continue;
+            if (best < 0 || priority(channels_[ch]) > priority(channels_[best])) best = ch;
+        }
+        return best;
+    }
+
+    // Elements until the channel's next half-transfer or completion point
+    static uint32_t to_milestone(const DMAChannel& chan) {
+        uint32_t half = chan.reload_count / 2;
+        return chan.remaining > half && half > 0 ? chan.remaining - half : chan.remaining;
+    }
+
+    // Do the transfers from last_cycle_ up to now. Request lines are
+    // sampled per element on peripheral channels and once per run on
+    // free-running ones. Idle cycles are not banked.
+    void sync(uint64_t now) {
+        if (idle_ || now <= last_cycle_) {
+            last_cycle_ = std::max(last_cycle_, now);
+            return;
+        }
+
+        uint64_t budget = now - last_cycle_;
+        while (budget > 0) {
+            int ch = next_channel();
+            if (ch < 0) break;
+            auto& chan = channels_[ch];
+
+            bool paced = !(chan.ccr & DMA_CCR::MEM2MEM) && !requests_[ch].empty();
+            uint32_t n = paced ? 1 : static_cast<uint32_t>(
+                std::min<uint64_t>(budget, to_milestone(chan)));
+            uint32_t before = chan.remaining;
+            transfer(ch, n);
+            budget -= n;
+            complete(ch, before);
+        }
+        last_cycle_ = now;
+    }
+
+    // Raise HT/TC after a run that started with `before` elements left
+    void complete(int ch, uint32_t before) {
+        auto& chan = channels_[ch];
+        uint32_t half = chan.reload_count / 2;
+        uint32_t shift = ch * 4;
+
+        if (before > half && chan.remaining <= half) {
+            isr_ |= (DMA_ISR::HTIF | DMA_ISR::GIF) << shift;
+            if (chan.ccr & DMA_CCR::HTIE) irq_pending_ |= 1u << ch;
+        }
+
+        if (chan.remaining == 0) {
+            isr_ |= (DMA_ISR::TCIF | DMA_ISR::GIF) << shift;
+            if (chan.ccr & DMA_CCR::TCIE) irq_pending_ |= 1u << ch;
+
+            if (chan.ccr & DMA_CCR::CIRC) {
+                // Circular mode: reload
+                chan.remaining = chan.reload_count;
+                chan.current_par = chan.cpar;
+                chan.current_mar = chan.cmar;
+            } else {
+                // One-shot: disable channel
+                chan.ccr &= ~DMA_CCR::EN;
+            }
+        }
+    }
+
+    // Post the next event: now for undelivered interrupts, else the next
+    // milestone of the channel being served
+    void reschedule(uint64_t now) {
+        int ch = next_channel();
+        idle_ = ch < 0;
+        if (irq_pending_) {
+            event_.schedule(now);
+        } else if (ch >= 0) {
+            event_.schedule(now + to_milestone(channels_[ch]));
+        } else {
+            event_.cancel();
+        }
+    }
 
     void start_channel(int ch) {
         auto& chan = channels_[ch];
@@ -212,66 +331,80 @@ private:
         chan.current_mar = chan.cmar;
     }
 
-    void do_transfer(int ch) {
-        auto& chan = channels_[ch];
+    // Source and destination of a channel's transfers
+    struct Route {
+        uint32_t* src;  // Current address fields of the channel
+        uint32_t* dst;
+        Width src_width, dst_width;
+        bool src_inc, dst_inc;
+    };
 
-        if (!bus_read_ || !bus_write_) return;
+    static Width width_of(uint32_t size) {
+        return (size == 0) ? Width::Byte : (size == 1) ? Width::Half : Width::Word;
+    }
 
-        // Determine transfer size
-        uint32_t psize = (chan.ccr & DMA_CCR::PSIZE_MASK) >> 8;
-        uint32_t msize = (chan.ccr & DMA_CCR::MSIZE_MASK) >> 10;
+    static uint32_t bytes_of(Width w) {
+        return (w == Width::Byte) ? 1 : (w == Width::Half) ? 2 : 4;
+    }
 
-        Width pw = (psize == 0) ? Width::Byte : (psize == 1) ? Width::Half : Width::Word;
-        Width mw = (msize == 0) ? Width::Byte : (msize == 1) ? Width::Half : Width::Word;
+    static Route route(DMAChannel& chan) {
+        Width pw = width_of((chan.ccr & DMA_CCR::PSIZE_MASK) >> 8);
+        Width mw = width_of((chan.ccr & DMA_CCR::MSIZE_MASK) >> 10);
+        bool pinc = chan.ccr & DMA_CCR::PINC;
+        bool minc = chan.ccr & DMA_CCR::MINC;
 
-        uint32_t src_addr, dst_addr;
-        Width src_width, dst_width;
-        bool src_inc, dst_inc;
-
-        if (chan.ccr & DMA_CCR::MEM2MEM) {
-            // Memory-to-memory: peripheral addr is actually source memory
-            src_addr = chan.current_par;
-            dst_addr = chan.current_mar;
-            src_width = pw;
-            dst_width = mw;
-            src_inc = chan.ccr & DMA_CCR::PINC;
-            dst_inc = chan.ccr & DMA_CCR::MINC;
-        } else if (chan.ccr & DMA_CCR::DIR) {
+        if ((chan.ccr & DMA_CCR::DIR) && !(chan.ccr & DMA_CCR::MEM2MEM)) {
             // Memory-to-peripheral
-            src_addr = chan.current_mar;
-            dst_addr = chan.current_par;
-            src_width = mw;
-            dst_width = pw;
-            src_inc = chan.ccr & DMA_CCR::MINC;
-            dst_inc = chan.ccr & DMA_CCR::PINC;
-        } else {
-            // Peripheral-to-memory
-            src_addr = chan.current_par;
-            dst_addr = chan.current_mar;
-            src_width = pw;
-            dst_width = mw;
-            src_inc = chan.ccr & DMA_CCR::PINC;
-            dst_inc = chan.ccr & DMA_CCR::MINC;
+            return {&chan.current_mar, &chan.current_par, mw, pw, minc, pinc};
         }
+        // Peripheral-to-memory, or memory-to-memory (peripheral addr is
+        // actually source memory)
+        return {&chan.current_par, &chan.current_mar, pw, mw, pinc, minc};
+    }
 
-        // Do the transfer
-        uint32_t data = bus_read_(src_addr, src_width);
-        bus_write_(dst_addr, dst_width, data);
-
-        // Update addresses
-        uint32_t src_step = (src_width == Width::Byte) ? 1 : (src_width == Width::Half) ? 2 : 4;
-        uint32_t dst_step = (dst_width == Width::Byte) ? 1 : (dst_width == Width::Half) ? 2 : 4;
+    // Move n elements. Equal-width runs between host memory (flash, SRAM,
+    // FSMC) with an incrementing destination are copied or filled in one go;
+    // everything else (peripheral registers, width conversion, overlapping
+    // forward copies) goes element by element through the bus.
+    void transfer(int ch, uint32_t n) {
+        auto& chan = channels_[ch];
+        Route r = route(chan);
+        uint32_t size = bytes_of(r.src_width);
+        uint32_t bytes = n * size;
+
+        bool overlap = r.src_inc && *r.dst > *r.src && *r.dst - *r.src < bytes;
+        if (bus_span_ && r.src_width == r.dst_width && r.dst_inc && !overlap) {
+            const uint8_t* src = bus_span_(*r.src, r.src_inc ? bytes : size, false);
+            uint8_t* dst = src ? bus_span_(*r.dst, bytes, true) : nullptr;
+            if (dst) {
+                if (r.src_inc) {
+                    std::memmove(dst, src, bytes);
+                    *r.src += bytes;
+                } else {
+                    for (uint32_t i = 0; i < bytes; i += size) std::memcpy(dst + i, src, size);
+                }
+                *r.dst += bytes;
+                chan.remaining -= n;
+                return;
+            }
+        }
 
-        if (chan.ccr & DMA_CCR::MEM2MEM) {
-            if (src_inc) chan.current_par += src_step;
-            if (dst_inc) chan.current_mar += dst_step;
-        } else if (chan.ccr & DMA_CCR::DIR) {
-            if (src_inc) chan.current_mar += src_step;
-            if (dst_inc) chan.current_par += dst_step;
-        } else {
-            if (src_inc) chan.current_par += src_step;
-            if (dst_inc) chan.current_mar += dst_step;
+        for (uint32_t i = 0; i < n; i++) {
+            do_transfer(ch);
         }
+    }
+
+    void do_transfer(int ch) {
+        auto& chan = channels_[ch];
+
+        if (!bus_read_ || !bus_write_) return;
+
+        Route r = route(chan);
+        uint32_t data = bus_read_(*r.src, r.src_width);
+        bus_write_(*r.dst, r.dst_width, data);
+
+        if (r.src_inc) *r.src += bytes_of(r.src_width);
+        if (r.dst_inc) *r.dst += bytes_of(r.dst_width);
 
         chan.remaining--;
     }
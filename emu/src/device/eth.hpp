@@ -8,6 +8,7 @@
 #pragma once
 
 #include "../bus.hpp"
+#include "../scheduler.hpp"
 #include <array>
 #include <cstdint>
 #include <cstdio>
@@ -195,6 +196,11 @@ public:
         bus_write_ = std::move(write);
     }
 
+    void set_event_slot(EventSlot slot) { event_ = slot; }
+
+    // Retry interval while received frames wait for an RX descriptor
+    static constexpr uint64_t RX_RETRY_CYCLES = 10000;
+
     // Set TFTP root directory
     void set_tftp_root(const std::string& path) {
         tftp_root_ = path;
@@ -226,6 +232,7 @@ public:
         switch (addr) {
             case ETH_Reg::MACCR:
                 maccr_ = val;
+                event_.schedule_now();
                 break;
             case ETH_Reg::MACA0HR:
                 mac_addr_high_ = val & 0xFFFF;
@@ -235,6 +242,7 @@ public:
                 break;
             case ETH_Reg::DMAOMR:
                 dmaomr_ = val;
+                event_.schedule_now();
                 break;
             case ETH_Reg::DMASR:
                 // Write 1 to clear status bits
@@ -251,10 +259,12 @@ public:
             case ETH_Reg::DMATPDR:
                 // TX Poll Demand - trigger TX processing
                 tx_poll_pending_ = true;
+                event_.schedule_now();
                 break;
             case ETH_Reg::DMARPDR:
                 // RX Poll Demand - trigger RX processing
                 rx_poll_pending_ = true;
+                event_.schedule_now();
                 break;
         }
     }
@@ -272,9 +282,14 @@ public:
             tx_poll_pending_ = false;
         }
 
-        // Process RX if enabled - deliver any pending frames
+        // Process RX if enabled - deliver one pending frame per event,
+        // retry later if no descriptor was available
         if ((maccr_ & ETH_MACCR::RE) && (dmaomr_ & ETH_DMAOMR::SR)) {
-            irq_pending |= process_rx();
+            bool delivered = process_rx();
+            irq_pending |= delivered;
+            if (!rx_queue_.empty()) {
+                event_.schedule(cycles + (delivered ? 1 : RX_RETRY_CYCLES));
+            }
         }
 
         if (irq_pending) {
@@ -305,6 +320,7 @@ private:
     uint32_t current_rx_desc_ = 0;
     bool tx_poll_pending_ = false;
     bool rx_poll_pending_ = false;
+    EventSlot event_;
 
     BusReadFn bus_read_;
     BusWriteFn bus_write_;
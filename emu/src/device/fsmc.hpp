@@ -1,12 +1,17 @@
 // FSMC - Flexible Static Memory Controller
 // External 1MB SRAM (IS62WV102416)
+//
+// The Bus accesses the memory directly (Bus::map_memory); read()/write()
+// only serve callers that go through the device. Writes are reported per
+// 4 KB page via Bus::watch_writes -> mark_dirty(), so the display can tell
+// whether the frame it shows (wherever its base register puts it) changed.
 
 #pragma once
 
 #include "../bus.hpp"
+#include <bitset>
 #include <cstdint>
 #include <cstring>
-#include <vector>
 
 namespace cosmo {
 
@@ -16,8 +21,12 @@ public:
     static constexpr uint32_t FRAMEBUFFER_OFFSET = 0xE0000;  // 896KB offset
     static constexpr uint32_t FRAMEBUFFER_SIZE = 0x20000;    // 128KB
 
-    FSMC() : memory_(SIZE, 0) {}
+    FSMC() : memory_(SIZE) {
+        dirty_.set();  // Everything is new at power-on
+    }
 
+    // Little-endian host: halfwords and words are accessed in one go.
+    // Accesses running past the end read as 0 / are dropped.
     uint32_t read(uint32_t addr, Width w) override {
         addr &= (SIZE - 1);
 
@@ -26,15 +35,16 @@ public:
                 return memory_[addr];
             case Width::Half:
                 if (addr + 1 < SIZE) {
-                    return memory_[addr] | (memory_[addr + 1] << 8);
+                    uint16_t v;
+                    std::memcpy(&v, &memory_[addr], 2);
+                    return v;
                 }
                 return memory_[addr];
             case Width::Word:
                 if (addr + 3 < SIZE) {
-                    return memory_[addr] |
-                           (memory_[addr + 1] << 8) |
-                           (memory_[addr + 2] << 16) |
-                           (memory_[addr + 3] << 24);
+                    uint32_t v;
+                    std::memcpy(&v, &memory_[addr], 4);
+                    return v;
                 }
                 return 0;
         }
@@ -50,36 +60,44 @@ public:
                 break;
             case Width::Half:
                 if (addr + 1 < SIZE) {
-                    memory_[addr] = val & 0xFF;
-                    memory_[addr + 1] = (val >> 8) & 0xFF;
+                    uint16_t v = static_cast<uint16_t>(val);
+                    std::memcpy(&memory_[addr], &v, 2);
                 }
                 break;
             case Width::Word:
                 if (addr + 3 < SIZE) {
-                    memory_[addr] = val & 0xFF;
-                    memory_[addr + 1] = (val >> 8) & 0xFF;
-                    memory_[addr + 2] = (val >> 16) & 0xFF;
-                    memory_[addr + 3] = (val >> 24) & 0xFF;
+                    std::memcpy(&memory_[addr], &val, 4);
                 }
                 break;
         }
+        mark_dirty(addr);
     }
 
-    // Direct access to framebuffer for rendering
-    const uint8_t* framebuffer() const {
-        return memory_.data() + FRAMEBUFFER_OFFSET;
-    }
+    // Direct memory access for DMA and rendering
+    const uint8_t* data() const { return memory_.data(); }
+    uint8_t* data() { return memory_.data(); }
+
+    // Dirty tracking, one bit per 4 KB page
+    static constexpr uint32_t DIRTY_PAGE_SIZE = 0x1000;
 
-    uint8_t* framebuffer() {
-        return memory_.data() + FRAMEBUFFER_OFFSET;
+    void mark_dirty(uint32_t offset) {
+        dirty_.set((offset & (SIZE - 1)) / DIRTY_PAGE_SIZE);
     }
 
-    // Direct memory access for DMA
-    const uint8_t* data() const { return memory_.data(); }
-    uint8_t* data() { return memory_.data(); }
+    // Any page of [offset, offset + size) written since the last call
+    // (starts a new period for the whole memory)
+    bool take_dirty(uint32_t offset, uint32_t size) {
+        bool d = false;
+        for (uint32_t p = offset / DIRTY_PAGE_SIZE; p <= (offset + size - 1) / DIRTY_PAGE_SIZE; p++) {
+            d |= dirty_.test(p);
+        }
+        dirty_.reset();
+        return d;
+    }
 
 private:
-    std::vector<uint8_t> memory_;
+    HostMemory memory_;
+    std::bitset<SIZE / DIRTY_PAGE_SIZE> dirty_;
 };
 
 } // namespace cosmo
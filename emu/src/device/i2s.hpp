@@ -4,8 +4,11 @@
 #pragma once
 
 #include "../bus.hpp"
+#include "../scheduler.hpp"
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace cosmo {
@@ -39,7 +42,7 @@ namespace I2S_STATUS {
 // I2S IRQ number
 constexpr uint32_t I2S_IRQ = 25;
 
-// DMA channel for I2S (convention)
+// DMA channel index for I2S requests (convention)
 constexpr uint32_t I2S_DMA_CH = 3;
 
 class I2S : public Device {
@@ -57,6 +60,15 @@ public:
         clkdiv_ = CPU_CLOCK / DEFAULT_SAMPLE_RATE;
     }
 
+    void set_event_slot(EventSlot slot) { event_ = slot; }
+
+    // Samples are pulled by the host audio device via read_samples()
+    // instead of being consumed at the sample clock
+    void set_host_drain(bool on) { host_drain_ = on; reschedule(); }
+
+    // Called when the DMA request line may have become active
+    void set_dma_notify(std::function<void()> fn) { dma_notify_ = std::move(fn); }
+
     uint32_t read(uint32_t addr, Width w) override {
         addr &= 0xFF;
 
@@ -84,15 +96,22 @@ public:
         addr &= 0xFF;
 
         switch (addr) {
-            case I2S_Reg::CTRL:
+            case I2S_Reg::CTRL: {
+                bool was_enabled = ctrl_ & I2S_CTRL::EN;
                 ctrl_ = val;
                 if (!(ctrl_ & I2S_CTRL::EN)) {
                     // Reset on disable
                     write_pos_ = 0;
                     read_pos_ = 0;
                     sample_count_ = 0;
+                } else if (!was_enabled) {
+                    // Sample clock starts now
+                    last_sample_cycle_ = event_.now();
                 }
+                reschedule();
+                notify_dma();
                 break;
+            }
 
             case I2S_Reg::STATUS:
                 // Read-only (or write-1-to-clear for flags)
@@ -104,32 +123,33 @@ public:
 
             case I2S_Reg::CLKDIV:
                 clkdiv_ = val;
+                reschedule();
                 break;
         }
     }
 
-    // Tick - consume samples at sample rate
+    // Sample clock event - consume samples at sample rate
     std::optional<Interrupt> tick(uint64_t cycles) override {
         if (!(ctrl_ & I2S_CTRL::EN)) return std::nullopt;
 
-        // Calculate cycles per sample
-        uint64_t cycles_per_sample = clkdiv_;
-        if (cycles_per_sample == 0) cycles_per_sample = 1;
+        // One sample per elapsed sample period
+        uint64_t periods = (cycles - last_sample_cycle_) / cycles_per_sample();
+        last_sample_cycle_ += periods * cycles_per_sample();
+        reschedule();
 
-        // Check if it's time to consume a sample
-        if (cycles - last_sample_cycle_ >= cycles_per_sample) {
-            last_sample_cycle_ = cycles;
+        if (periods == 0) return std::nullopt;
 
-            if (sample_count_ > 0) {
-                // Consume one stereo sample (2 values)
-                read_pos_ = (read_pos_ + 2) % buffer_.size();
-                sample_count_--;
-            }
+        if (!host_drain_) {
+            // Consume stereo samples (2 values each)
+            size_t n = std::min<uint64_t>(periods, sample_count_);
+            read_pos_ = (read_pos_ + 2 * n) % buffer_.size();
+            sample_count_ -= n;
+        }
+        notify_dma();
 
-            // Generate interrupt if buffer below threshold and interrupts enabled
-            if ((ctrl_ & I2S_CTRL::TXIE) && sample_count_ < HALF_BUFFER) {
-                return Interrupt{I2S_IRQ};
-            }
+        // Generate interrupt if buffer below threshold and interrupts enabled
+        if ((ctrl_ & I2S_CTRL::TXIE) && sample_count_ < HALF_BUFFER) {
+            return Interrupt{I2S_IRQ};
         }
 
         return std::nullopt;
@@ -172,6 +192,30 @@ private:
     size_t read_pos_ = 0;
     size_t sample_count_ = 0;
     uint64_t last_sample_cycle_ = 0;
+    bool host_drain_ = false;
+    EventSlot event_;
+    std::function<void()> dma_notify_;
+
+    uint64_t cycles_per_sample() const {
+        return clkdiv_ ? clkdiv_ : 1;
+    }
+
+    void notify_dma() {
+        if (dma_notify_ && dma_request()) dma_notify_();
+    }
+
+    // The sample clock only needs events if it consumes samples, may
+    // raise the TX interrupt or has to re-assert the DMA request (with
+    // host drain the buffer empties outside of the emulation)
+    void reschedule() {
+        bool needed = (ctrl_ & I2S_CTRL::EN) &&
+                      (!host_drain_ || (ctrl_ & (I2S_CTRL::TXIE | I2S_CTRL::DMAE)));
+        if (needed) {
+            event_.schedule(last_sample_cycle_ + cycles_per_sample());
+        } else {
+            event_.cancel();
+        }
+    }
 
     uint32_t get_status() const {
         uint32_t status = 0;
@@ -1,16 +1,15 @@
 #pragma once
 #include "../bus.hpp"
-#include <vector>
 #include <cstring>
 #include <fstream>
 
 namespace cosmo {
 
 class RAM : public Device {
-    std::vector<uint8_t> data_;
+    HostMemory data_;
 
 public:
-    explicit RAM(size_t size) : data_(size, 0) {}
+    explicit RAM(size_t size) : data_(size) {}
 
     uint8_t* data() { return data_.data(); }
     size_t size() const { return data_.size(); }
@@ -48,10 +47,10 @@ public:
 };
 
 class ROM : public Device {
-    std::vector<uint8_t> data_;
+    HostMemory data_;
 
 public:
-    explicit ROM(size_t size) : data_(size, 0) {}
+    explicit ROM(size_t size) : data_(size) {}
 
     uint8_t* data() { return data_.data(); }
     size_t size() const { return data_.size(); }
@@ -1,5 +1,6 @@
 #pragma once
 #include "../bus.hpp"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
@@ -15,19 +16,24 @@ namespace cosmo {
 //   0x044 RESERVED
 //   0x048 CFGR       - Configuration
 //   0x04C GISR       - Global Interrupt Status
-//   0x060 VTFIDR     - VTF Interrupt ID
-//   0x080 VTFADDR0-3 - VTF Addresses
+//   0x060 VTFIDR     - VTF Interrupt ID (one IRQ number per byte)
+//   0x080 VTFADDR0-3 - VTF Addresses (bit 0: enable)
 //   0x100 IENR0-3    - Interrupt Enable (set)
 //   0x180 IRER0-3    - Interrupt Enable (clear)
 //   0x200 IPSR0-3    - Interrupt Pending (set)
 //   0x280 IPRR0-3    - Interrupt Pending (clear)
 //   0x300 IACTR0-3   - Interrupt Active
 //   0x400 IPRIOR0-63 - Priority (4 bits per interrupt, 8 per word)
+//
+// Vector-table-free (VTF) interrupts: up to four IRQs, named in VTFIDR, jump
+// straight to the address in their enabled VTFADDR register instead of
+// going through mtvec.
 
 class PFIC : public Device {
 public:
     static constexpr size_t NUM_INTERRUPTS = 128;
     static constexpr size_t NUM_WORDS = NUM_INTERRUPTS / 32;
+    static constexpr size_t NUM_VTF = 4;
 
 private:
     std::array<uint32_t, NUM_WORDS> pending_{};   // Interrupt pending
@@ -37,8 +43,52 @@ private:
 
     uint32_t threshold_ = 0;  // Only IRQs with priority < threshold are taken
     uint32_t cfgr_ = 0;
+    uint32_t vtf_id_ = 0;
+    std::array<uint32_t, NUM_VTF> vtf_addr_{};
+
+    // IRQs grouped by priority level, and the cached result of
+    // get_pending_irq(), recomputed after any state change
+    static constexpr size_t NUM_LEVELS = 16;
+    std::array<std::array<uint32_t, NUM_WORDS>, NUM_LEVELS> level_{};
+    mutable int best_irq_ = -1;
+    mutable bool best_valid_ = false;
+
+    bool* doorbell_ = nullptr;
+
+    // State changed: drop the cached lookup and let the CPU re-check
+    void invalidate() {
+        best_valid_ = false;
+        if (doorbell_) *doorbell_ = true;
+    }
+
+    void set_priority(size_t irq, uint8_t prio) {
+        uint32_t bit = 1U << (irq % 32);
+        level_[priority_[irq]][irq / 32] &= ~bit;
+        priority_[irq] = prio;
+        level_[prio][irq / 32] |= bit;
+    }
+
+    // Levels in priority order (lower number first), IRQ number order
+    // within a level: the first pending and enabled IRQ wins
+    int find_best() const {
+        size_t levels = threshold_ ? std::min<size_t>(threshold_, NUM_LEVELS) : NUM_LEVELS;
+        for (size_t p = 0; p < levels; p++) {
+            for (size_t i = 0; i < NUM_WORDS; i++) {
+                uint32_t m = pending_[i] & enabled_[i] & level_[p][i];
+                if (m) return static_cast<int>(i * 32 + __builtin_ctz(m));
+            }
+        }
+        return -1;
+    }
 
 public:
+    PFIC() {
+        level_[0].fill(~0U);  // All IRQs start at priority 0
+    }
+
+    // Flag to set whenever an interrupt may have become deliverable
+    void set_doorbell(bool* flag) { doorbell_ = flag; }
+
     uint32_t read(uint32_t addr, Width) override {
         // ISR - Status (same as pending for simplicity)
         if (addr >= 0x000 && addr < 0x010) {
@@ -60,6 +110,11 @@ public:
             }
             return any_pending;
         }
+        // VTF
+        if (addr == 0x060) return vtf_id_;
+        if (addr >= 0x080 && addr < 0x090) {
+            return vtf_addr_[(addr - 0x080) / 4];
+        }
         // IENR - Enabled
         if (addr >= 0x100 && addr < 0x110) {
             return enabled_[(addr - 0x100) / 4];
@@ -83,6 +138,8 @@ public:
     }
 
     void write(uint32_t addr, Width, uint32_t val) override {
+        invalidate();
+
         // IPR - Pending (direct write)
         if (addr >= 0x020 && addr < 0x030) {
             pending_[(addr - 0x020) / 4] = val;
@@ -98,6 +155,15 @@ public:
             cfgr_ = val;
             return;
         }
+        // VTF
+        if (addr == 0x060) {
+            vtf_id_ = val;
+            return;
+        }
+        if (addr >= 0x080 && addr < 0x090) {
+            vtf_addr_[(addr - 0x080) / 4] = val;
+            return;
+        }
         // IENR - Enable set
         if (addr >= 0x100 && addr < 0x110) {
             enabled_[(addr - 0x100) / 4] |= val;
@@ -128,7 +194,7 @@ public:
             size_t word_idx = (addr - 0x400) / 4;
             size_t base_irq = word_idx * 8;
             for (size_t i = 0; i < 8 && base_irq + i < NUM_INTERRUPTS; i++) {
-                priority_[base_irq + i] = (val >> (i * 4)) & 0xF;
+                set_priority(base_irq + i, (val >> (i * 4)) & 0xF);
             }
             return;
         }
@@ -137,6 +203,7 @@ public:
     // Set interrupt pending (called by peripherals)
     void set_pending(uint32_t irq) {
         if (irq < NUM_INTERRUPTS) {
+            invalidate();
             pending_[irq / 32] |= (1U << (irq % 32));
         }
     }
@@ -144,6 +211,7 @@ public:
     // Clear interrupt pending
     void clear_pending(uint32_t irq) {
         if (irq < NUM_INTERRUPTS) {
+            invalidate();
             pending_[irq / 32] &= ~(1U << (irq % 32));
         }
     }
@@ -163,31 +231,21 @@ public:
     // Get highest priority pending and enabled interrupt
     // Returns -1 if none, otherwise IRQ number
     int get_pending_irq() const {
-        int best_irq = -1;
-        uint8_t best_prio = 0xFF;
-
-        for (size_t i = 0; i < NUM_WORDS; i++) {
-            uint32_t pending_enabled = pending_[i] & enabled_[i];
-            if (pending_enabled == 0) continue;
-
-            for (size_t bit = 0; bit < 32; bit++) {
-                if (pending_enabled & (1U << bit)) {
-                    size_t irq = i * 32 + bit;
-                    uint8_t prio = priority_[irq];
-
-                    // Check threshold
-                    if (prio >= threshold_ && threshold_ != 0) continue;
-
-                    // Check if this is higher priority (lower number = higher priority)
-                    if (prio < best_prio) {
-                        best_prio = prio;
-                        best_irq = static_cast<int>(irq);
-                    }
-                }
-            }
+        if (!best_valid_) {
+            best_irq_ = find_best();
+            best_valid_ = true;
         }
+        return best_irq_;
+    }
 
-        return best_irq;
+    // VTF entry point for an IRQ, 0 if it goes through mtvec
+    uint32_t vtf_address(uint32_t irq) const {
+        for (size_t i = 0; i < NUM_VTF; i++) {
+            if (((vtf_id_ >> (i * 8)) & 0xFF) == irq && (vtf_addr_[i] & 1)) {
+                return vtf_addr_[i] & ~1U;
+            }
+        }
+        return 0;
     }
 
     // Mark interrupt as being serviced
@@ -202,10 +260,15 @@ public:
     // Clear active status (called on return from interrupt)
     void clear_active(uint32_t irq) {
         if (irq < NUM_INTERRUPTS) {
+            invalidate();
             active_[irq / 32] &= ~(1U << (irq % 32));
         }
     }
 
+    uint8_t priority(uint32_t irq) const {
+        return irq < NUM_INTERRUPTS ? priority_[irq] : 0;
+    }
+
     // Check if any interrupt is active
     bool any_active() const {
         for (auto a : active_) {
@@ -217,6 +280,7 @@ public:
     // Enable an interrupt
     void enable_irq(uint32_t irq) {
         if (irq < NUM_INTERRUPTS) {
+            invalidate();
             enabled_[irq / 32] |= (1U << (irq % 32));
         }
     }
@@ -224,6 +288,7 @@ public:
     // Disable an interrupt
     void disable_irq(uint32_t irq) {
         if (irq < NUM_INTERRUPTS) {
+            invalidate();
             enabled_[irq / 32] &= ~(1U << (irq % 32));
         }
     }
@@ -1,5 +1,7 @@
 #pragma once
 #include "../bus.hpp"
+#include "../scheduler.hpp"
+#include <algorithm>
 #include <cstdint>
 
 namespace cosmo {
@@ -17,6 +19,11 @@ namespace cosmo {
 //   0x18 RELOAD  - Auto-reload value (for periodic mode)
 //
 // Simplified compared to full mtime, optimized for SysTick use case
+//
+// The counter runs at the CPU clock. While enabled it is not stored but
+// derived from the cycle at which it was zero, so reads are exact at the
+// cycle of the access and counting costs nothing. The only event is the
+// next compare match; periodic reloads are folded into the start cycle.
 
 class SysTickTimer : public Device {
 public:
@@ -34,19 +41,47 @@ public:
 private:
     uint32_t ctrl_ = 0;
     uint32_t sr_ = 0;
-    uint64_t cnt_ = 0;
+    uint64_t cnt_ = 0;    // Counter value while disabled
+    uint64_t start_ = 0;  // CPU cycle at which the counter was 0 (while enabled)
     uint64_t cmp_ = 0;
     uint32_t reload_ = 0;
 
     bool irq_pending_ = false;
 
+    EventSlot event_;
+
+    bool enabled() const { return ctrl_ & CTRL_ENABLE; }
+
+    uint64_t count_at(uint64_t now) const {
+        return enabled() ? now - start_ : cnt_;
+    }
+
+    void set_count_at(uint64_t now, uint64_t value) {
+        if (enabled()) {
+            start_ = now - value;
+        } else {
+            cnt_ = value;
+        }
+    }
+
+    // Post the compare-match event for the current configuration
+    void reschedule(uint64_t now) {
+        if (!enabled() || cmp_ == 0) {
+            event_.cancel();
+        } else {
+            event_.schedule(std::max(now, start_ + cmp_));
+        }
+    }
+
 public:
+    void set_event_slot(EventSlot slot) { event_ = slot; }
+
     uint32_t read(uint32_t addr, Width) override {
         switch (addr) {
             case 0x00: return ctrl_;
             case 0x04: return sr_;
-            case 0x08: return static_cast<uint32_t>(cnt_);
-            case 0x0C: return static_cast<uint32_t>(cnt_ >> 32);
+            case 0x08: return static_cast<uint32_t>(count_at(event_.now()));
+            case 0x0C: return static_cast<uint32_t>(count_at(event_.now()) >> 32);
             case 0x10: return static_cast<uint32_t>(cmp_);
             case 0x14: return static_cast<uint32_t>(cmp_ >> 32);
             case 0x18: return reload_;
@@ -55,9 +90,13 @@ public:
     }
 
     void write(uint32_t addr, Width, uint32_t val) override {
+        uint64_t now = event_.now();
+        uint64_t cnt = count_at(now);
+
         switch (addr) {
             case 0x00:
                 ctrl_ = val;
+                set_count_at(now, cnt);  // Freeze or restart the counter
                 if (!(val & CTRL_ENABLE)) {
                     irq_pending_ = false;
                 }
@@ -70,10 +109,10 @@ public:
                 }
                 break;
             case 0x08:
-                cnt_ = (cnt_ & 0xFFFFFFFF00000000ULL) | val;
+                set_count_at(now, (cnt & 0xFFFFFFFF00000000ULL) | val);
                 break;
             case 0x0C:
-                cnt_ = (cnt_ & 0xFFFFFFFFULL) | (static_cast<uint64_t>(val) << 32);
+                set_count_at(now, (cnt & 0xFFFFFFFFULL) | (static_cast<uint64_t>(val) << 32));
                 break;
             case 0x10:
                 cmp_ = (cmp_ & 0xFFFFFFFF00000000ULL) | val;
@@ -85,44 +124,53 @@ public:
                 reload_ = val;
                 break;
         }
-    }
 
-    std::optional<Interrupt> tick(uint64_t) override {
-        if (!(ctrl_ & CTRL_ENABLE)) {
-            return {};
-        }
-
-        cnt_++;
+        reschedule(now);
+    }
 
-        if (cnt_ >= cmp_ && cmp_ != 0) {
+    // Compare-match event
+    std::optional<Interrupt> tick(uint64_t cycles) override {
+        std::optional<Interrupt> irq;
+        uint64_t cnt = count_at(cycles);
+        if (enabled() && cnt >= cmp_ && cmp_ != 0) {
             sr_ |= SR_CNTIF;
 
             if (ctrl_ & CTRL_MODE) {
-                // Periodic mode - reload
-                cnt_ = 0;
+                // Periodic mode - reload (keep cycles past the match).
+                // Matches missed in between (compare changed to a value
+                // already passed) collapse into this one.
+                cnt -= cmp_;
                 if (reload_ != 0) {
                     cmp_ = reload_;
                 }
+                if (cnt >= cmp_) cnt %= cmp_;
+                start_ = cycles - cnt;
             } else {
-                // One-shot - disable
+                // One-shot - disable, counter stops at its current value
                 ctrl_ &= ~CTRL_ENABLE;
+                cnt_ = cnt;
             }
 
             if ((ctrl_ & CTRL_TICKINT) && !irq_pending_) {
                 irq_pending_ = true;
-                return Interrupt{IRQ_NUM};
+                irq = Interrupt{IRQ_NUM};
             }
         }
 
-        return {};
+        reschedule(cycles);
+        return irq;
     }
 
     bool has_pending_irq() const { return irq_pending_; }
     void clear_irq() { irq_pending_ = false; }
 
     // Direct access for testing
-    uint64_t count() const { return cnt_; }
-    void set_count(uint64_t v) { cnt_ = v; }
+    uint64_t count() const { return count_at(event_.now()); }
+    void set_count(uint64_t v) {
+        uint64_t now = event_.now();
+        set_count_at(now, v);
+        reschedule(now);
+    }
 };
 
 } // namespace cosmo
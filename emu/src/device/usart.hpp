@@ -14,7 +14,7 @@ namespace cosmo {
 //   0x08 BRR    - Baud Rate Register (rw, ignored)
 //   0x0C CTLR1  - Control Register 1 (rw)
 //   0x10 CTLR2  - Control Register 2 (rw, ignored)
-//   0x14 CTLR3  - Control Register 3 (rw, ignored)
+//   0x14 CTLR3  - Control Register 3 (rw, DMA enables only)
 //   0x18 GPR    - Guard time and prescaler (rw, ignored)
 
 class USART : public Device {
@@ -30,6 +30,14 @@ public:
     static constexpr uint32_t CTLR1_TE     = 1 << 3;  // TX enable
     static constexpr uint32_t CTLR1_RE     = 1 << 2;  // RX enable
 
+    // Control register 3 bits
+    static constexpr uint32_t CTLR3_DMAT = 1 << 7;  // DMA enable transmitter
+    static constexpr uint32_t CTLR3_DMAR = 1 << 6;  // DMA enable receiver
+
+    // DMA1 channel indices of the request lines (CH4/CH5 on the CH32V307)
+    static constexpr int DMA_TX_CH = 3;
+    static constexpr int DMA_RX_CH = 4;
+
     // Default IRQ number for USART1 (CH32V307)
     static constexpr uint32_t DEFAULT_IRQ = 37;
 
@@ -49,9 +57,14 @@ private:
     OutputCallback output_cb_;
     PFIC* pfic_ = nullptr;
     uint32_t irq_num_ = DEFAULT_IRQ;
+    std::function<void()> dma_notify_;
 
     void update_irq();
 
+    void notify_dma() {
+        if (dma_notify_ && (dma_tx_request() || dma_rx_request())) dma_notify_();
+    }
+
 public:
     USART() : output_cb_([](char c) { std::putchar(c); std::fflush(stdout); }) {}
 
@@ -65,6 +78,7 @@ public:
         if (rx_queue_.size() < RX_QUEUE_MAX) {
             rx_queue_.push_back(byte);
             update_irq();
+            notify_dma();
         }
     }
 
@@ -74,6 +88,7 @@ public:
             rx_queue_.push_back(static_cast<uint8_t>(*str++));
         }
         update_irq();
+        notify_dma();
     }
 
     bool has_input() const { return !rx_queue_.empty(); }
@@ -82,6 +97,17 @@ public:
         output_cb_ = std::move(cb);
     }
 
+    // Called when a DMA request line may have become active
+    void set_dma_notify(std::function<void()> fn) { dma_notify_ = std::move(fn); }
+
+    // DMA request lines: TX is always ready, RX while data is queued
+    bool dma_tx_request() const {
+        return (ctlr3_ & CTLR3_DMAT) && (ctlr1_ & CTLR1_UE) && (ctlr1_ & CTLR1_TE);
+    }
+    bool dma_rx_request() const {
+        return (ctlr3_ & CTLR3_DMAR) && (ctlr1_ & CTLR1_UE) && !rx_queue_.empty();
+    }
+
     uint32_t read(uint32_t addr, Width) override {
         switch (addr) {
             case 0x00: {
@@ -129,9 +155,13 @@ public:
             case 0x0C:
                 ctlr1_ = val;
                 update_irq();  // Re-evaluate IRQ when RXNEIE changes
+                notify_dma();
                 break;
             case 0x10: ctlr2_ = val; break;
-            case 0x14: ctlr3_ = val; break;
+            case 0x14:
+                ctlr3_ = val;
+                notify_dma();
+                break;
             case 0x18: gpr_ = val; break;
         }
     }
@@ -0,0 +1,144 @@
+#include "fastmem.hpp"
+#include "bus.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef COSMO_FASTMEM
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace cosmo {
+
+#ifdef COSMO_FASTMEM
+
+// Bounds of the access site table (provided by the linker)
+extern "C" const fastmem::Site __start_cosmo_fastmem_sites[];
+extern "C" const fastmem::Site __stop_cosmo_fastmem_sites[];
+
+namespace {
+
+Fastmem* instances = nullptr;
+struct sigaction previous_action;
+
+int prot_for(Fastmem::Access access) {
+    switch (access) {
+        case Fastmem::Access::None: return PROT_NONE;
+        case Fastmem::Access::Read: return PROT_READ;
+        case Fastmem::Access::ReadWrite: return PROT_READ | PROT_WRITE;
+    }
+    return PROT_NONE;
+}
+
+const fastmem::Site* find_site(uintptr_t rip) {
+    for (const fastmem::Site* s = __start_cosmo_fastmem_sites; s != __stop_cosmo_fastmem_sites; s++) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(&s->start) + s->start;
+        if (start == rip) return s;
+    }
+    return nullptr;
+}
+
+} // anonymous namespace
+
+HostMemory::HostMemory(size_t size) : size_(size) {
+    size_t bytes = (size + Bus::PAGE_MASK) & ~static_cast<size_t>(Bus::PAGE_MASK);
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        std::perror("mmap");
+        std::abort();
+    }
+    data_ = static_cast<uint8_t*>(p);
+}
+
+HostMemory::~HostMemory() {
+    munmap(data_, (size_ + Bus::PAGE_MASK) & ~static_cast<size_t>(Bus::PAGE_MASK));
+}
+
+bool Fastmem::available() {
+    return sysconf(_SC_PAGESIZE) == Bus::PAGE_SIZE;
+}
+
+Fastmem::Fastmem() {
+    void* p = mmap(nullptr, ARENA_SIZE + GUARD_SIZE, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        std::fprintf(stderr, "[FASTMEM] Failed to reserve guest address space\n");
+        return;
+    }
+    base_ = static_cast<uint8_t*>(p);
+
+    if (!instances) {
+        struct sigaction sa = {};
+        sa.sa_sigaction = [](int sig, siginfo_t* info, void* context) {
+            on_fault(sig, info, context);
+        };
+        sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGSEGV, &sa, &previous_action);
+    }
+    next_ = instances;
+    instances = this;
+}
+
+Fastmem::~Fastmem() {
+    if (!base_) return;
+    for (Fastmem** p = &instances; *p; p = &(*p)->next_) {
+        if (*p == this) {
+            *p = next_;
+            break;
+        }
+    }
+    if (!instances) sigaction(SIGSEGV, &previous_action, nullptr);
+    munmap(base_, ARENA_SIZE + GUARD_SIZE);
+}
+
+bool Fastmem::alias(uint32_t guest, uint8_t* host, uint32_t size, Access access) {
+    // old_size 0 on a shared mapping creates a second mapping of the same pages
+    void* p = mremap(host, 0, size, MREMAP_MAYMOVE | MREMAP_FIXED, base_ + guest);
+    if (p == MAP_FAILED) return false;
+    protect(guest, size, access);
+    return true;
+}
+
+void Fastmem::protect(uint32_t guest, uint32_t size, Access access) {
+    mprotect(base_ + guest, size, prot_for(access));
+}
+
+void Fastmem::on_fault(int, void*, void* context) {
+    auto* uc = static_cast<ucontext_t*>(context);
+    greg_t* regs = uc->uc_mcontext.gregs;
+
+    const fastmem::Site* site = find_site(static_cast<uintptr_t>(regs[REG_RIP]));
+    uint8_t* host = reinterpret_cast<uint8_t*>(regs[REG_RDI]);
+    Fastmem* fm = instances;
+    while (fm && !(host >= fm->base_ && host < fm->base_ + ARENA_SIZE)) fm = fm->next_;
+
+    if (!site || !fm) {
+        // Not ours: restore the previous handler and let the access fault again
+        sigaction(SIGSEGV, &previous_action, nullptr);
+        return;
+    }
+
+    // Skip the access and report it as not done; the caller retries it
+    // through the Bus slow path outside the signal handler
+    regs[REG_RCX] = 0;
+    regs[REG_RIP] += site->len;
+}
+
+#else
+
+HostMemory::HostMemory(size_t size) : data_(new uint8_t[size]()), size_(size) {}
+HostMemory::~HostMemory() { delete[] data_; }
+
+bool Fastmem::available() { return false; }
+Fastmem::Fastmem() {}
+Fastmem::~Fastmem() = default;
+bool Fastmem::alias(uint32_t, uint8_t*, uint32_t, Access) { return false; }
+void Fastmem::protect(uint32_t, uint32_t, Access) {}
+void Fastmem::on_fault(int, void*, void*) {}
+
+#endif
+
+} // namespace cosmo
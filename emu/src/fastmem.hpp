@@ -0,0 +1,156 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define COSMO_FASTMEM 1
+#endif
+
+namespace cosmo {
+
+// Page-aligned, zero-initialised host storage for guest memory (flash, SRAM,
+// FSMC). Where fastmem is available this is a shared mapping, so the same
+// pages can also be mapped into the fastmem arena.
+class HostMemory {
+public:
+    explicit HostMemory(size_t size);
+    ~HostMemory();
+
+    HostMemory(const HostMemory&) = delete;
+    HostMemory& operator=(const HostMemory&) = delete;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    uint8_t& operator[](size_t i) { return data_[i]; }
+    const uint8_t& operator[](size_t i) const { return data_[i]; }
+
+private:
+    uint8_t* data_;
+    size_t size_;
+};
+
+// Optional memory backend: the whole 32-bit guest address space as one
+// reserved host region (--fastmem)
+//
+// Bus::set_fastmem() maps the host memory of every RAM-like page (flash
+// read-only, SRAM and FSMC read/write) into the arena at its guest address
+// and leaves all other pages inaccessible. Bus::try_read/try_write then do
+// a single arena + addr host access for every guest address. Accesses to
+// MMIO or unmapped pages, writes to flash and the first write to a
+// write-tracked page fault instead; the SIGSEGV handler recognises the
+// faulting host instruction as one of the access sites below, clears the
+// site's done flag and resumes after it. try_read/try_write then return
+// false and the caller takes the Bus slow path as it would without
+// fastmem, so the CPU publishes its cycle count and sees irq_doorbell
+// exactly as on the page table path. No device code runs in the handler.
+//
+// Only available on x86-64 Linux; available() is false elsewhere.
+
+class Fastmem {
+public:
+    static constexpr uint64_t ARENA_SIZE = 1ULL << 32;
+    static constexpr uint64_t GUARD_SIZE = 64 * 1024;  // Accesses past 0xFFFFFFFF
+
+    enum class Access { None, Read, ReadWrite };
+
+    Fastmem();
+    ~Fastmem();
+
+    Fastmem(const Fastmem&) = delete;
+    Fastmem& operator=(const Fastmem&) = delete;
+
+    static bool available();
+
+    // Start of the arena, nullptr if the reservation failed
+    uint8_t* base() const { return base_; }
+
+    // Map the host pages [host, host + size) (from HostMemory) at guest
+    // address `guest`. Both must be page aligned.
+    bool alias(uint32_t guest, uint8_t* host, uint32_t size, Access access);
+
+    // Change the protection of an aliased guest range
+    void protect(uint32_t guest, uint32_t size, Access access);
+
+private:
+    uint8_t* base_ = nullptr;
+    Fastmem* next_ = nullptr;  // Live instances, searched by the fault handler
+
+    static void on_fault(int sig, void* info, void* context);
+};
+
+#ifdef COSMO_FASTMEM
+
+// Host access sites for arena accesses. Each one is a single instruction
+// with the host address in RDI, recorded in the cosmo_fastmem_sites section
+// so the fault handler can skip it. ECX is set to 1 before the access and
+// cleared by the handler: the return value is false if the access did not
+// happen and has to go through the Bus slow path.
+namespace fastmem {
+
+enum SiteKind : uint32_t { LOAD8, LOAD16, LOAD32, STORE8, STORE16, STORE32 };
+
+struct Site {
+    int32_t start;   // Instruction address, relative to this field
+    uint32_t len;    // Instruction length
+    uint32_t kind;
+};
+
+#define COSMO_FASTMEM_SITE(kind)                    \
+    ".pushsection cosmo_fastmem_sites, \"a?\"\n"    \
+    ".balign 4\n"                                   \
+    ".long 1b - .\n"                                \
+    ".long 2b - 1b\n"                               \
+    ".long " #kind "\n"                             \
+    ".popsection\n"
+
+inline bool load8(const uint8_t* p, uint32_t& v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movzbl (%2), %0\n2:\n" COSMO_FASTMEM_SITE(0)
+                 : "=&a"(v), "=&c"(done) : "D"(p), "m"(*p));
+    return done;
+}
+
+inline bool load16(const uint8_t* p, uint32_t& v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movzwl (%2), %0\n2:\n" COSMO_FASTMEM_SITE(1)
+                 : "=&a"(v), "=&c"(done) : "D"(p), "m"(*reinterpret_cast<const uint16_t*>(p)));
+    return done;
+}
+
+inline bool load32(const uint8_t* p, uint32_t& v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movl (%2), %0\n2:\n" COSMO_FASTMEM_SITE(2)
+                 : "=&a"(v), "=&c"(done) : "D"(p), "m"(*reinterpret_cast<const uint32_t*>(p)));
+    return done;
+}
+
+inline bool store8(uint8_t* p, uint32_t v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movb %b2, (%3)\n2:\n" COSMO_FASTMEM_SITE(3)
+                 : "=m"(*p), "=&c"(done) : "a"(v), "D"(p));
+    return done;
+}
+
+inline bool store16(uint8_t* p, uint32_t v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movw %w2, (%3)\n2:\n" COSMO_FASTMEM_SITE(4)
+                 : "=m"(*reinterpret_cast<uint16_t*>(p)), "=&c"(done) : "a"(v), "D"(p));
+    return done;
+}
+
+inline bool store32(uint8_t* p, uint32_t v) {
+    uint32_t done;
+    asm volatile("movl $1, %1\n1: movl %2, (%3)\n2:\n" COSMO_FASTMEM_SITE(5)
+                 : "=m"(*reinterpret_cast<uint32_t*>(p)), "=&c"(done) : "a"(v), "D"(p));
+    return done;
+}
+
+#undef COSMO_FASTMEM_SITE
+
+} // namespace fastmem
+
+#endif
+
+} // namespace cosmo
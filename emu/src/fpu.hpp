@@ -0,0 +1,197 @@
+#pragma once
+#include <cfenv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace cosmo {
+
+// RV32F helpers: single-precision arithmetic on the host FPU
+//
+// Float registers hold raw IEEE-754 bit patterns. Arithmetic runs on host
+// floats and NaN results are replaced by the RISC-V canonical NaN.
+// Exception flags come from the host's sticky flags: the CPU clears them
+// when it starts executing and folds them into fflags when it stops or
+// fcsr is accessed (CPU::sync_fflags), so fast-path operations need no
+// flag handling of their own.
+//
+// Rounding modes other than round-to-nearest-even switch the host rounding
+// mode around the operation. RMM has no host equivalent and goes through
+// rmm(), which rounds a double-precision result by hand.
+namespace fpu {
+
+constexpr uint32_t CANONICAL_NAN = 0x7FC00000;
+constexpr uint32_t SIGN = 0x80000000;
+
+// fflags bits
+constexpr uint32_t NX = 1 << 0;  // Inexact
+constexpr uint32_t UF = 1 << 1;  // Underflow
+constexpr uint32_t OF = 1 << 2;  // Overflow
+constexpr uint32_t DZ = 1 << 3;  // Divide by zero
+constexpr uint32_t NV = 1 << 4;  // Invalid operation
+
+// Rounding modes (rm field and frm)
+enum RoundingMode : uint32_t { RNE = 0, RTZ = 1, RDN = 2, RUP = 3, RMM = 4, DYN = 7 };
+
+inline float to_float(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof f);
+    return f;
+}
+
+inline uint32_t to_bits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof bits);
+    return bits;
+}
+
+// Register value for an arithmetic result
+inline uint32_t result(float f) {
+    return std::isnan(f) ? CANONICAL_NAN : to_bits(f);
+}
+
+inline bool is_nan(uint32_t b) { return (b & ~SIGN) > 0x7F800000; }
+inline bool is_snan(uint32_t b) { return is_nan(b) && !(b & 0x00400000); }
+
+// Host exception flags raised since the last call, as fflags bits
+inline uint32_t take_host_flags() {
+    int e = std::fetestexcept(FE_ALL_EXCEPT);
+    if (!e) return 0;
+    std::feclearexcept(FE_ALL_EXCEPT);
+    return ((e & FE_INEXACT) ? NX : 0) | ((e & FE_UNDERFLOW) ? UF : 0) |
+           ((e & FE_OVERFLOW) ? OF : 0) | ((e & FE_DIVBYZERO) ? DZ : 0) |
+           ((e & FE_INVALID) ? NV : 0);
+}
+
+// Host rounding mode for the lifetime of the object. Operands and results
+// of the rounded operation should go through volatiles so the compiler
+// keeps the arithmetic between the mode switches.
+class Rounding {
+public:
+    explicit Rounding(uint32_t rm) : set_(rm != RNE && rm != RMM) {
+        if (set_) std::fesetround(rm == RTZ ? FE_TOWARDZERO : rm == RDN ? FE_DOWNWARD : FE_UPWARD);
+    }
+    ~Rounding() {
+        if (set_) std::fesetround(FE_TONEAREST);
+    }
+
+    Rounding(const Rounding&) = delete;
+    Rounding& operator=(const Rounding&) = delete;
+
+private:
+    bool set_;
+};
+
+// Result of op() rounded to float with RMM (to nearest, ties away from
+// zero). op() computes in double precision with round-toward-zero, and the
+// inexact flag is folded into the lowest bit ("round to odd"), which keeps
+// enough of the exact result for one correct rounding to float. This holds
+// for float operands: their products and int32 values are exact in double.
+template <typename Op>
+inline float rmm(Op op) {
+    std::fexcept_t saved;
+    std::fegetexceptflag(&saved, FE_ALL_EXCEPT);
+    std::feclearexcept(FE_ALL_EXCEPT);
+    std::fesetround(FE_TOWARDZERO);
+    volatile double vd = op();
+    std::fesetround(FE_TONEAREST);
+    double d = vd;
+    int raised = std::fetestexcept(FE_ALL_EXCEPT);
+    std::fesetexceptflag(&saved, FE_ALL_EXCEPT);
+    std::feraiseexcept(raised & (FE_INVALID | FE_DIVBYZERO));
+    if (std::isnan(d) || std::isinf(d) || d == 0) return static_cast<float>(d);
+
+    // Float results never get near the double subnormal range
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    if (raised & FE_INEXACT) bits |= 1;
+    int exp = static_cast<int>((bits >> 52) & 0x7FF) - 1023;
+    uint64_t m = (bits & ((1ULL << 52) - 1)) | (1ULL << 52);
+
+    // Drop the bits below the result's last place: 29 for normal floats,
+    // more for subnormal ones (all of them below half the smallest one)
+    int shift = exp < -126 ? -97 - exp : 29;
+    uint64_t q = shift > 53 ? 0 : (m + (1ULL << (shift - 1))) >> shift;
+    bool inexact = shift > 53 || (m & ((1ULL << shift) - 1)) != 0;
+    float r = static_cast<float>(std::ldexp(static_cast<double>(q), exp - 52 + shift));  // Raises OF
+    if (inexact) {
+        // Tininess is detected after rounding (unbounded exponent)
+        bool tiny = exp < -127 || (exp == -127 && (m + (1ULL << 28)) >> 29 < (1ULL << 24));
+        std::feraiseexcept(tiny ? FE_INEXACT | FE_UNDERFLOW : FE_INEXACT);
+    }
+    return (bits >> 63) ? -r : r;
+}
+
+// FMIN.S / FMAX.S: a NaN operand yields the other one, -0 < +0
+inline uint32_t min_max(uint32_t a, uint32_t b, bool max, uint32_t& flags) {
+    if (is_snan(a) || is_snan(b)) flags |= NV;
+    if (is_nan(a) && is_nan(b)) return CANONICAL_NAN;
+    if (is_nan(a)) return b;
+    if (is_nan(b)) return a;
+    float fa = to_float(a), fb = to_float(b);
+    if (fa == fb) return max ? (a & b) : (a | b);  // Only differ for +-0
+    return (fa < fb) != max ? a : b;
+}
+
+// FEQ.S / FLT.S / FLE.S (ordered compares signal on any NaN)
+inline uint32_t compare(uint32_t a, uint32_t b, uint32_t f3, uint32_t& flags) {
+    if (is_nan(a) || is_nan(b)) {
+        if (f3 != 2 || is_snan(a) || is_snan(b)) flags |= NV;
+        return 0;
+    }
+    float fa = to_float(a), fb = to_float(b);
+    switch (f3) {
+        case 0: return fa <= fb;
+        case 1: return fa < fb;
+        default: return fa == fb;
+    }
+}
+
+// FCVT.W.S / FCVT.WU.S: out-of-range values and NaN saturate
+inline uint32_t to_int(uint32_t a, uint32_t rm, bool is_signed, uint32_t& flags) {
+    uint32_t max = is_signed ? 0x7FFFFFFF : 0xFFFFFFFF;
+    uint32_t min = is_signed ? 0x80000000 : 0;
+    if (is_nan(a)) {
+        flags |= NV;
+        return max;
+    }
+    float f = to_float(a);
+    double r;
+    switch (rm) {
+        case RTZ: r = std::trunc(f); break;
+        case RDN: r = std::floor(f); break;
+        case RUP: r = std::ceil(f); break;
+        case RMM: r = std::round(f); break;
+        default:  r = std::nearbyint(f); break;
+    }
+    if (r < (is_signed ? -2147483648.0 : 0.0)) {
+        flags |= NV;
+        return min;
+    }
+    if (r > (is_signed ? 2147483647.0 : 4294967295.0)) {
+        flags |= NV;
+        return max;
+    }
+    if (r != f) flags |= NX;
+    return is_signed ? static_cast<uint32_t>(static_cast<int32_t>(r)) : static_cast<uint32_t>(r);
+}
+
+// FCLASS.S: one-hot class mask
+inline uint32_t classify(uint32_t a) {
+    bool neg = a & SIGN;
+    uint32_t exp = (a >> 23) & 0xFF;
+    uint32_t frac = a & 0x7FFFFF;
+    if (exp == 0xFF) {
+        if (frac == 0) return neg ? 1u << 0 : 1u << 7;  // -inf / +inf
+        return (frac & 0x400000) ? 1u << 9 : 1u << 8;   // qNaN / sNaN
+    }
+    if (exp == 0) {
+        if (frac == 0) return neg ? 1u << 3 : 1u << 4;  // -0 / +0
+        return neg ? 1u << 2 : 1u << 5;                 // Subnormal
+    }
+    return neg ? 1u << 1 : 1u << 6;                     // Normal
+}
+
+} // namespace fpu
+
+} // namespace cosmo
@@ -0,0 +1,657 @@
+#include "jit.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COSMO_JIT_X64 1
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace cosmo {
+
+#ifdef COSMO_JIT_X64
+
+namespace {
+
+// ============================================================================
+// Runtime helpers called from translated code
+// ============================================================================
+
+uint32_t jit_read(Bus* bus, uint32_t addr, uint32_t width) {
+    return bus->read(addr, static_cast<Width>(width));
+}
+
+void jit_write(Bus* bus, uint32_t addr, uint32_t val, uint32_t width) {
+    bus->write(addr, static_cast<Width>(width), val);
+}
+
+// Division semantics as in CPU::run (RISC-V: no traps on divide by zero)
+uint32_t jit_div(uint32_t s1, uint32_t s2) {
+    return s2 == 0 ? ~0u : (s1 == 0x80000000 && s2 == ~0u) ? s1
+                         : static_cast<uint32_t>(static_cast<int32_t>(s1) / static_cast<int32_t>(s2));
+}
+uint32_t jit_divu(uint32_t s1, uint32_t s2) { return s2 ? s1 / s2 : ~0u; }
+uint32_t jit_rem(uint32_t s1, uint32_t s2) {
+    return s2 == 0 ? s1 : (s1 == 0x80000000 && s2 == ~0u) ? 0
+                        : static_cast<uint32_t>(static_cast<int32_t>(s1) % static_cast<int32_t>(s2));
+}
+uint32_t jit_remu(uint32_t s1, uint32_t s2) { return s2 ? s1 % s2 : s1; }
+
+// Zbb ops without a baseline x86-64 instruction
+uint32_t jit_clz(uint32_t s1) { return s1 ? __builtin_clz(s1) : 32; }
+uint32_t jit_ctz(uint32_t s1) { return s1 ? __builtin_ctz(s1) : 32; }
+uint32_t jit_cpop(uint32_t s1) { return __builtin_popcount(s1); }
+uint32_t jit_orcb(uint32_t s1) {
+    uint32_t r = 0;
+    for (int i = 0; i < 32; i += 8) {
+        if ((s1 >> i) & 0xFF) r |= 0xFFu << i;
+    }
+    return r;
+}
+
+// ============================================================================
+// x86-64 encoder (only the forms the translator needs)
+// ============================================================================
+
+enum Reg : uint8_t {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Host ABI argument registers
+#ifdef _WIN32
+constexpr Reg ARG0 = RCX, ARG1 = RDX, ARG2 = R8, ARG3 = R9;
+constexpr uint8_t FRAME = 40;   // 32 bytes shadow space + alignment
+#else
+constexpr Reg ARG0 = RDI, ARG1 = RSI, ARG2 = RDX, ARG3 = RCX;
+constexpr uint8_t FRAME = 8;    // Alignment only
+#endif
+
+// Guest register file base pointer and host registers for hot guest regs
+// (all callee-saved on both ABIs, so helper calls preserve them)
+constexpr Reg STATE = R15;
+constexpr std::array<Reg, 5> ALLOC_REGS = {RBX, RBP, R12, R13, R14};
+constexpr std::array<Reg, 6> SAVED_REGS = {RBX, RBP, R12, R13, R14, R15};
+
+// x86 condition codes
+enum Cond : uint8_t {
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+    CC_L = 0xC, CC_GE = 0xD, CC_G = 0xF
+};
+
+// ALU opcodes (r/m32, r32 form) and their /ext for the imm32 form
+struct AluOp { uint8_t rr; uint8_t ext; };
+constexpr AluOp ADD_{0x01, 0}, OR_{0x09, 1}, AND_{0x21, 4}, SUB_{0x29, 5}, XOR_{0x31, 6}, CMP_{0x39, 7};
+
+class Emitter {
+    uint8_t* buf_;
+    size_t cap_;
+    size_t pos_ = 0;
+
+public:
+    Emitter(uint8_t* buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+    size_t pos() const { return pos_; }
+    bool overflow() const { return pos_ > cap_; }
+
+    void byte(uint8_t b) { if (pos_ < cap_) buf_[pos_] = b; pos_++; }
+    void imm32(uint32_t v) { for (int i = 0; i < 4; i++) byte(v >> (i * 8)); }
+    void imm64(uint64_t v) { for (int i = 0; i < 8; i++) byte(v >> (i * 8)); }
+
+    void rex(bool w, uint8_t r, uint8_t b, uint8_t x = 0, bool force = false) {
+        uint8_t v = 0x40 | (w << 3) | ((r >> 3) << 2) | ((x >> 3) << 1) | (b >> 3);
+        if (v != 0x40 || force) byte(v);
+    }
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        byte((mod << 6) | ((reg & 7) << 3) | (rm & 7));
+    }
+    // [base + disp32]
+    void mem(uint8_t reg, Reg base, int32_t disp) {
+        modrm(2, reg, base);
+        if ((base & 7) == RSP) byte(0x24);
+        imm32(disp);
+    }
+    // [base + index]
+    void mem_bi(uint8_t reg, Reg base, Reg index) {
+        modrm(2, reg, RSP);
+        byte(((index & 7) << 3) | (base & 7));
+        imm32(0);
+    }
+
+    // 32-bit register ops
+    void mov(Reg dst, Reg src) { rex(false, src, dst); byte(0x89); modrm(3, src, dst); }
+    void mov(Reg dst, uint32_t imm) { rex(false, 0, dst); byte(0xB8 + (dst & 7)); imm32(imm); }
+    void mov64(Reg dst, uint64_t imm) { rex(true, 0, dst); byte(0xB8 + (dst & 7)); imm64(imm); }
+    void alu(AluOp op, Reg dst, Reg src) { rex(false, src, dst); byte(op.rr); modrm(3, src, dst); }
+    void alu(AluOp op, Reg dst, uint32_t imm) { rex(false, 0, dst); byte(0x81); modrm(3, op.ext, dst); imm32(imm); }
+    void shift_cl(uint8_t ext, Reg dst) { rex(false, 0, dst); byte(0xD3); modrm(3, ext, dst); }
+    void shift(uint8_t ext, Reg dst, uint8_t n) { rex(false, 0, dst); byte(0xC1); modrm(3, ext, dst); byte(n); }
+    void not_(Reg dst) { rex(false, 0, dst); byte(0xF7); modrm(3, 2, dst); }
+    void bswap(Reg dst) { rex(false, 0, dst); byte(0x0F); byte(0xC8 + (dst & 7)); }
+    void imul(Reg dst, Reg src) { rex(false, dst, src); byte(0x0F); byte(0xAF); modrm(3, dst, src); }
+    void setcc(Cond cc, Reg dst) { rex(false, 0, dst, 0, dst >= RSP); byte(0x0F); byte(0x90 | cc); modrm(3, 0, dst); }
+    void cmov(Cond cc, Reg dst, Reg src) { rex(false, dst, src); byte(0x0F); byte(0x40 | cc); modrm(3, dst, src); }
+    void movzx8(Reg dst, Reg src) { rex(false, dst, src, 0, src >= RSP); byte(0x0F); byte(0xB6); modrm(3, dst, src); }
+    void movsx8(Reg dst, Reg src) { rex(false, dst, src, 0, src >= RSP); byte(0x0F); byte(0xBE); modrm(3, dst, src); }
+    void movsx16(Reg dst, Reg src) { rex(false, dst, src); byte(0x0F); byte(0xBF); modrm(3, dst, src); }
+    void movzx16(Reg dst, Reg src) { rex(false, dst, src); byte(0x0F); byte(0xB7); modrm(3, dst, src); }
+
+    // 64-bit ops for the high half of multiplications
+    void movsxd(Reg dst, Reg src) { rex(true, dst, src); byte(0x63); modrm(3, dst, src); }
+    void imul64(Reg dst, Reg src) { rex(true, dst, src); byte(0x0F); byte(0xAF); modrm(3, dst, src); }
+    void shr64(Reg dst, uint8_t n) { rex(true, 0, dst); byte(0xC1); modrm(3, 5, dst); byte(n); }
+
+    // Memory access
+    void load(Reg dst, Reg base, int32_t disp) { rex(false, dst, base); byte(0x8B); mem(dst, base, disp); }
+    void store(Reg base, int32_t disp, Reg src) { rex(false, src, base); byte(0x89); mem(src, base, disp); }
+    void load_bi(Width w, Reg dst, Reg base, Reg index) {
+        rex(false, dst, base, index);
+        switch (w) {
+            case Width::Byte: byte(0x0F); byte(0xB6); break;  // movzx r32, byte
+            case Width::Half: byte(0x0F); byte(0xB7); break;  // movzx r32, word
+            case Width::Word: byte(0x8B); break;
+        }
+        mem_bi(dst, base, index);
+    }
+    void store_bi(Width w, Reg base, Reg index, Reg src) {
+        if (w == Width::Half) byte(0x66);
+        rex(false, src, base, index, w == Width::Byte && src >= RSP);
+        byte(w == Width::Byte ? 0x88 : 0x89);
+        mem_bi(src, base, index);
+    }
+
+    // Stack and control flow
+    void push(Reg r) { rex(false, 0, r); byte(0x50 + (r & 7)); }
+    void pop(Reg r) { rex(false, 0, r); byte(0x58 + (r & 7)); }
+    void sub_rsp(uint8_t n) { byte(0x48); byte(0x83); byte(0xEC); byte(n); }
+    void add_rsp(uint8_t n) { byte(0x48); byte(0x83); byte(0xC4); byte(n); }
+    void call(const void* fn) { mov64(RAX, reinterpret_cast<uint64_t>(fn)); byte(0xFF); byte(0xD0); }
+    void ret() { byte(0xC3); }
+
+    // Forward jumps: emit with zero displacement, patch once target is known
+    size_t jcc(Cond cc) { byte(0x0F); byte(0x80 | cc); imm32(0); return pos_; }
+    size_t jmp() { byte(0xE9); imm32(0); return pos_; }
+    void patch(size_t after) {
+        int32_t rel = static_cast<int32_t>(pos_ - after);
+        if (after <= cap_) std::memcpy(buf_ + after - 4, &rel, 4);
+    }
+};
+
+// ============================================================================
+// Block translator
+// ============================================================================
+
+class Translator {
+    Emitter& e_;
+    Bus* bus_;
+    std::array<int8_t, 32> host_{};   // Guest reg -> index in ALLOC_REGS, -1 = memory
+    std::array<bool, 32> dirty_{};
+
+public:
+    Translator(Emitter& e, Bus* bus) : e_(e), bus_(bus) { host_.fill(-1); }
+
+    // Map the most used guest registers of the block to host registers
+    void allocate(const DecodedInst* insts, uint32_t count) {
+        std::array<uint32_t, 32> uses{};
+        for (uint32_t i = 0; i < count; i++) {
+            uses[insts[i].rd]++;
+            uses[insts[i].rs1]++;
+            uses[insts[i].rs2]++;
+        }
+        uses[0] = 0;
+        for (size_t slot = 0; slot < ALLOC_REGS.size(); slot++) {
+            auto best = std::max_element(uses.begin(), uses.end());
+            if (*best < 2) break;
+            host_[best - uses.begin()] = static_cast<int8_t>(slot);
+            *best = 0;
+        }
+    }
+
+    void emit_prologue() {
+        for (Reg r : SAVED_REGS) e_.push(r);
+        e_.sub_rsp(FRAME);
+        // mov r15, ARG0 (64-bit)
+        e_.rex(true, ARG0, STATE); e_.byte(0x89); e_.modrm(3, ARG0, STATE);
+        for (int g = 1; g < 32; g++) {
+            if (host_[g] >= 0) e_.load(ALLOC_REGS[host_[g]], STATE, g * 4);
+        }
+    }
+
+    // Next PC must already be in EAX
+    void emit_epilogue() {
+        for (int g = 1; g < 32; g++) {
+            if (host_[g] >= 0 && dirty_[g]) e_.store(STATE, g * 4, ALLOC_REGS[host_[g]]);
+        }
+        e_.add_rsp(FRAME);
+        for (auto it = SAVED_REGS.rbegin(); it != SAVED_REGS.rend(); ++it) e_.pop(*it);
+        e_.ret();
+    }
+
+    // Guest register -> host scratch
+    void get(uint32_t g, Reg dst) {
+        if (g == 0) e_.alu(XOR_, dst, dst);
+        else if (host_[g] >= 0) e_.mov(dst, ALLOC_REGS[host_[g]]);
+        else e_.load(dst, STATE, g * 4);
+    }
+
+    // Host scratch -> guest register (writes to x0 are dropped)
+    void put(uint32_t g, Reg src) {
+        if (g == 0) return;
+        if (host_[g] >= 0) {
+            e_.mov(ALLOC_REGS[host_[g]], src);
+            dirty_[g] = true;
+        } else {
+            e_.store(STATE, g * 4, src);
+        }
+    }
+
+    void binop(const DecodedInst& di, AluOp op) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        e_.alu(op, RAX, RCX);
+        put(di.rd, RAX);
+    }
+
+    void immop(const DecodedInst& di, AluOp op) {
+        get(di.rs1, RAX);
+        e_.alu(op, RAX, static_cast<uint32_t>(di.imm));
+        put(di.rd, RAX);
+    }
+
+    void shiftop(const DecodedInst& di, uint8_t ext) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);   // x86 masks the count to 5 bits, like RISC-V
+        e_.shift_cl(ext, RAX);
+        put(di.rd, RAX);
+    }
+
+    void shiftimm(const DecodedInst& di, uint8_t ext) {
+        get(di.rs1, RAX);
+        e_.shift(ext, RAX, static_cast<uint8_t>(di.imm));
+        put(di.rd, RAX);
+    }
+
+    void setop(const DecodedInst& di, Cond cc, bool imm) {
+        get(di.rs1, RCX);
+        if (imm) e_.alu(CMP_, RCX, static_cast<uint32_t>(di.imm));
+        else { get(di.rs2, RDX); e_.alu(CMP_, RCX, RDX); }
+        e_.setcc(cc, RAX);
+        e_.movzx8(RAX, RAX);
+        put(di.rd, RAX);
+    }
+
+    // High 32 bits of a 64-bit product; sign-extends the selected operands
+    void mulhigh(const DecodedInst& di, bool sign1, bool sign2) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        if (sign1) e_.movsxd(RAX, RAX);
+        if (sign2) e_.movsxd(RCX, RCX);
+        e_.imul64(RAX, RCX);
+        e_.shr64(RAX, 32);
+        put(di.rd, RAX);
+    }
+
+    void helper2(const DecodedInst& di, const void* fn) {
+        get(di.rs1, ARG0);
+        get(di.rs2, ARG1);
+        e_.call(fn);
+        put(di.rd, RAX);
+    }
+
+    void helper1(const DecodedInst& di, const void* fn) {
+        get(di.rs1, ARG0);
+        e_.call(fn);
+        put(di.rd, RAX);
+    }
+
+    // SH1ADD/SH2ADD/SH3ADD: (rs1 << n) + rs2
+    void shadd(const DecodedInst& di, uint8_t n) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        e_.shift(4, RAX, n);
+        e_.alu(ADD_, RAX, RCX);
+        put(di.rd, RAX);
+    }
+
+    // ANDN/ORN/XNOR: rs1 op ~rs2
+    void notop(const DecodedInst& di, AluOp op) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        e_.not_(RCX);
+        e_.alu(op, RAX, RCX);
+        put(di.rd, RAX);
+    }
+
+    // MIN/MAX[U]: rs1, replaced by rs2 if cc(rs1, rs2) holds
+    void minmax(const DecodedInst& di, Cond cc) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        e_.alu(CMP_, RAX, RCX);
+        e_.cmov(cc, RAX, RCX);
+        put(di.rd, RAX);
+    }
+
+    // SEXT.B/SEXT.H/ZEXT.H/REV8
+    template <typename F>
+    void unop(const DecodedInst& di, F op) {
+        get(di.rs1, RAX);
+        op();
+        put(di.rd, RAX);
+    }
+
+    // BCLR/BINV/BSET: rs1 op (1 << rs2), inverted mask for BCLR
+    void bitop(const DecodedInst& di, AluOp op, bool invert) {
+        get(di.rs1, RAX);
+        get(di.rs2, RCX);
+        e_.mov(RDX, 1u);
+        e_.shift_cl(4, RDX);
+        if (invert) e_.not_(RDX);
+        e_.alu(op, RAX, RDX);
+        put(di.rd, RAX);
+    }
+
+    // BEXT/BEXTI: (rs1 >> index) & 1
+    void bextop(const DecodedInst& di, bool imm) {
+        get(di.rs1, RAX);
+        if (imm) {
+            e_.shift(5, RAX, static_cast<uint8_t>(di.imm));
+        } else {
+            get(di.rs2, RCX);
+            e_.shift_cl(5, RAX);
+        }
+        e_.alu(AND_, RAX, 1u);
+        put(di.rd, RAX);
+    }
+
+    // Effective address -> EAX; inline window check -> ECX = SRAM offset.
+    // Returns the patch position of the jump to the slow path.
+    size_t sram_check(const DecodedInst& di, uint32_t bytes) {
+        get(di.rs1, RAX);
+        if (di.imm) e_.alu(ADD_, RAX, static_cast<uint32_t>(di.imm));
+        e_.mov(RCX, RAX);
+        e_.alu(SUB_, RCX, bus_->sram_base());
+        e_.alu(CMP_, RCX, bus_->sram_size() - bytes);
+        return e_.jcc(CC_A);
+    }
+
+    void loadop(const DecodedInst& di, Width w, bool sign) {
+        uint32_t bytes = w == Width::Byte ? 1 : w == Width::Half ? 2 : 4;
+        size_t slow = sram_check(di, bytes);
+        e_.mov64(RDX, reinterpret_cast<uint64_t>(bus_->sram_data()));
+        e_.load_bi(w, RAX, RDX, RCX);
+        size_t done = e_.jmp();
+
+        e_.patch(slow);
+        e_.mov(ARG1, RAX);
+        e_.mov(ARG2, static_cast<uint32_t>(w));
+        e_.mov64(ARG0, reinterpret_cast<uint64_t>(bus_));
+        e_.call(reinterpret_cast<const void*>(&jit_read));
+
+        e_.patch(done);
+        if (sign && w == Width::Byte) e_.movsx8(RAX, RAX);
+        if (sign && w == Width::Half) e_.movsx16(RAX, RAX);
+        put(di.rd, RAX);
+    }
+
+    void storeop(const DecodedInst& di, Width w) {
+        uint32_t bytes = w == Width::Byte ? 1 : w == Width::Half ? 2 : 4;
+        get(di.rs2, R8);
+        size_t slow = sram_check(di, bytes);
+        e_.mov64(RDX, reinterpret_cast<uint64_t>(bus_->sram_data()));
+        e_.store_bi(w, RDX, RCX, R8);
+        size_t done = e_.jmp();
+
+        e_.patch(slow);
+        // Value first: on Windows it already sits in its argument register
+        if (ARG2 != R8) e_.mov(ARG2, R8);
+        e_.mov(ARG1, RAX);
+        e_.mov(ARG3, static_cast<uint32_t>(w));
+        e_.mov64(ARG0, reinterpret_cast<uint64_t>(bus_));
+        e_.call(reinterpret_cast<const void*>(&jit_write));
+
+        e_.patch(done);
+    }
+
+    // Conditional branch: EAX = taken ? target : fallthrough
+    void branchop(const DecodedInst& di, uint32_t pc, Cond cc) {
+        get(di.rs1, RCX);
+        get(di.rs2, RDX);
+        e_.alu(CMP_, RCX, RDX);
+        e_.mov(RAX, pc + di.len);
+        e_.mov(RDX, pc + di.imm);
+        e_.cmov(cc, RAX, RDX);
+    }
+
+    // Translate one instruction. Returns false for instructions that
+    // must be left to the interpreter.
+    bool emit(const DecodedInst& di, uint32_t pc) {
+        switch (di.op) {
+            case Uop::NOP: break;
+
+            case Uop::ADD:  binop(di, ADD_); break;
+            case Uop::SUB:  binop(di, SUB_); break;
+            case Uop::XOR:  binop(di, XOR_); break;
+            case Uop::OR:   binop(di, OR_); break;
+            case Uop::AND:  binop(di, AND_); break;
+            case Uop::SLL:  shiftop(di, 4); break;
+            case Uop::SRL:  shiftop(di, 5); break;
+            case Uop::SRA:  shiftop(di, 7); break;
+            case Uop::SLT:  setop(di, CC_L, false); break;
+            case Uop::SLTU: setop(di, CC_B, false); break;
+
+            case Uop::MUL:
+                get(di.rs1, RAX);
+                get(di.rs2, RCX);
+                e_.imul(RAX, RCX);
+                put(di.rd, RAX);
+                break;
+            case Uop::MULH:   mulhigh(di, true, true); break;
+            case Uop::MULHSU: mulhigh(di, true, false); break;
+            case Uop::MULHU:  mulhigh(di, false, false); break;
+            case Uop::DIV:    helper2(di, reinterpret_cast<const void*>(&jit_div)); break;
+            case Uop::DIVU:   helper2(di, reinterpret_cast<const void*>(&jit_divu)); break;
+            case Uop::REM:    helper2(di, reinterpret_cast<const void*>(&jit_rem)); break;
+            case Uop::REMU:   helper2(di, reinterpret_cast<const void*>(&jit_remu)); break;
+
+            case Uop::ADDI:  immop(di, ADD_); break;
+            case Uop::XORI:  immop(di, XOR_); break;
+            case Uop::ORI:   immop(di, OR_); break;
+            case Uop::ANDI:  immop(di, AND_); break;
+            case Uop::SLTI:  setop(di, CC_L, true); break;
+            case Uop::SLTIU: setop(di, CC_B, true); break;
+            case Uop::SLLI:  shiftimm(di, 4); break;
+            case Uop::SRLI:  shiftimm(di, 5); break;
+            case Uop::SRAI:  shiftimm(di, 7); break;
+
+            case Uop::SH1ADD: shadd(di, 1); break;
+            case Uop::SH2ADD: shadd(di, 2); break;
+            case Uop::SH3ADD: shadd(di, 3); break;
+            case Uop::ANDN:   notop(di, AND_); break;
+            case Uop::ORN:    notop(di, OR_); break;
+            case Uop::XNOR:   notop(di, XOR_); break;
+            case Uop::MIN:    minmax(di, CC_G); break;
+            case Uop::MINU:   minmax(di, CC_A); break;
+            case Uop::MAX:    minmax(di, CC_L); break;
+            case Uop::MAXU:   minmax(di, CC_B); break;
+            case Uop::ROL:    shiftop(di, 0); break;
+            case Uop::ROR:    shiftop(di, 1); break;
+            case Uop::RORI:   shiftimm(di, 1); break;
+            case Uop::CLZ:    helper1(di, reinterpret_cast<const void*>(&jit_clz)); break;
+            case Uop::CTZ:    helper1(di, reinterpret_cast<const void*>(&jit_ctz)); break;
+            case Uop::CPOP:   helper1(di, reinterpret_cast<const void*>(&jit_cpop)); break;
+            case Uop::ORCB:   helper1(di, reinterpret_cast<const void*>(&jit_orcb)); break;
+            case Uop::SEXTB:  unop(di, [&] { e_.movsx8(RAX, RAX); }); break;
+            case Uop::SEXTH:  unop(di, [&] { e_.movsx16(RAX, RAX); }); break;
+            case Uop::ZEXTH:  unop(di, [&] { e_.movzx16(RAX, RAX); }); break;
+            case Uop::REV8:   unop(di, [&] { e_.bswap(RAX); }); break;
+            case Uop::BCLR:   bitop(di, AND_, true); break;
+            case Uop::BINV:   bitop(di, XOR_, false); break;
+            case Uop::BSET:   bitop(di, OR_, false); break;
+            case Uop::BEXT:   bextop(di, false); break;
+            case Uop::BEXTI:  bextop(di, true); break;
+            case Uop::BCLRI:
+                get(di.rs1, RAX);
+                e_.alu(AND_, RAX, ~(1u << di.imm));
+                put(di.rd, RAX);
+                break;
+            case Uop::BINVI:
+                get(di.rs1, RAX);
+                e_.alu(XOR_, RAX, 1u << di.imm);
+                put(di.rd, RAX);
+                break;
+            case Uop::BSETI:
+                get(di.rs1, RAX);
+                e_.alu(OR_, RAX, 1u << di.imm);
+                put(di.rd, RAX);
+                break;
+
+            case Uop::LB:  loadop(di, Width::Byte, true); break;
+            case Uop::LH:  loadop(di, Width::Half, true); break;
+            case Uop::LW:  loadop(di, Width::Word, false); break;
+            case Uop::LBU: loadop(di, Width::Byte, false); break;
+            case Uop::LHU: loadop(di, Width::Half, false); break;
+
+            case Uop::SB: storeop(di, Width::Byte); break;
+            case Uop::SH: storeop(di, Width::Half); break;
+            case Uop::SW: storeop(di, Width::Word); break;
+
+            case Uop::LUI:
+                e_.mov(RAX, static_cast<uint32_t>(di.imm));
+                put(di.rd, RAX);
+                break;
+            case Uop::AUIPC:
+                e_.mov(RAX, pc + di.imm);
+                put(di.rd, RAX);
+                break;
+
+            case Uop::BEQ:  branchop(di, pc, CC_E); break;
+            case Uop::BNE:  branchop(di, pc, CC_NE); break;
+            case Uop::BLT:  branchop(di, pc, CC_L); break;
+            case Uop::BGE:  branchop(di, pc, CC_GE); break;
+            case Uop::BLTU: branchop(di, pc, CC_B); break;
+            case Uop::BGEU: branchop(di, pc, CC_AE); break;
+
+            case Uop::JAL:
+                e_.mov(RAX, pc + di.len);
+                put(di.rd, RAX);
+                e_.mov(RAX, pc + di.imm);
+                break;
+            case Uop::JALR:
+                get(di.rs1, RDX);
+                e_.alu(ADD_, RDX, static_cast<uint32_t>(di.imm));
+                e_.alu(AND_, RDX, ~1u);
+                e_.mov(RAX, pc + di.len);
+                put(di.rd, RAX);
+                e_.mov(RAX, RDX);
+                break;
+
+            case Uop::FLW: case Uop::FSW:
+            case Uop::FADD: case Uop::FSUB: case Uop::FMUL: case Uop::FDIV:
+            case Uop::FMADD: case Uop::FMSUB: case Uop::FNMSUB: case Uop::FNMADD:
+            case Uop::FP:
+            case Uop::SYSTEM:
+            case Uop::AMO:
+            case Uop::ILLEGAL:
+                return false;
+        }
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+bool Jit::available() { return true; }
+
+Jit::Jit(Bus* bus) : bus_(bus) {
+#ifdef _WIN32
+    void* p = VirtualAlloc(nullptr, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    void* p = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) p = nullptr;
+#endif
+    if (!p) std::fprintf(stderr, "[JIT] Failed to allocate code buffer, JIT disabled\n");
+    code_ = static_cast<uint8_t*>(p);
+}
+
+Jit::~Jit() {
+    if (!code_) return;
+#ifdef _WIN32
+    VirtualFree(code_, 0, MEM_RELEASE);
+#else
+    munmap(code_, CODE_SIZE);
+#endif
+}
+
+void Jit::reset(uint32_t code_end) {
+    blocks_.assign(code_end / 2, Block{});
+    code_used_ = 0;
+    translated_ = 0;
+}
+
+const Jit::Block* Jit::translate(uint32_t pc, const DecodedInst* insts, uint32_t count) {
+    Block* b = &blocks_[pc >> 1];
+    b->hits = 0;
+    if (!code_) return nullptr;
+
+    // Translate up to the first instruction the interpreter must handle
+    // (FP state lives in the CPU, so RV32F stays interpreted too)
+    uint32_t n = 0;
+    while (n < count && !(insts[n].op >= Uop::FLW && insts[n].op <= Uop::FP) &&
+           insts[n].op != Uop::SYSTEM && insts[n].op != Uop::AMO && insts[n].op != Uop::ILLEGAL) {
+        n++;
+    }
+    if (n == 0) return nullptr;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        Emitter e(code_ + code_used_, CODE_SIZE - code_used_);
+        Translator t(e, bus_);
+        t.allocate(insts, n);
+        t.emit_prologue();
+
+        uint32_t ipc = pc;
+        for (uint32_t i = 0; i < n; i++) {
+            t.emit(insts[i], ipc);
+            if (i + 1 < n) ipc += insts[i].len;
+        }
+        // Blocks not ending in a branch/jump fall through to the next PC
+        if (!ends_block(insts[n - 1].op)) e.mov(RAX, ipc + insts[n - 1].len);
+        t.emit_epilogue();
+
+        if (!e.overflow()) {
+            b->fn = reinterpret_cast<BlockFn>(code_ + code_used_);
+            b->count = n;
+            code_used_ += (e.pos() + 15) & ~size_t{15};
+            translated_++;
+            return b;
+        }
+
+        // Code buffer full: start over with an empty buffer (reset()
+        // reassigns blocks_, so look the entry up again)
+        uint32_t code_end = static_cast<uint32_t>(blocks_.size() * 2);
+        reset(code_end);
+        b = &blocks_[pc >> 1];
+    }
+    return nullptr;
+}
+
+#else // !COSMO_JIT_X64
+
+bool Jit::available() { return false; }
+Jit::Jit(Bus* bus) : bus_(bus) {}
+Jit::~Jit() = default;
+void Jit::reset(uint32_t code_end) { blocks_.assign(code_end / 2, Block{}); }
+const Jit::Block* Jit::translate(uint32_t pc, const DecodedInst*, uint32_t) {
+    blocks_[pc >> 1].hits = 0;
+    return nullptr;
+}
+
+#endif
+
+} // namespace cosmo
@@ -0,0 +1,77 @@
+#pragma once
+#include "bus.hpp"
+#include "decode.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cosmo {
+
+// x86-64 dynamic binary translator for hot guest code
+//
+// Works on top of BlockCache: CPU::run counts entries of each predecoded
+// basic block and hands it to the JIT once it has run HOT_THRESHOLD times.
+// The block is translated into a host function that
+//   - keeps the most used guest registers in callee-saved host registers,
+//   - accesses SRAM inline and goes through the Bus for everything else
+//     (flash, FSMC, MMIO), so device side effects stay in program order,
+//   - returns the next guest PC.
+// SYSTEM, AMO, RV32F and illegal instructions are never translated: a block
+// containing one of them is translated up to that instruction and the
+// interpreter takes over from there.
+//
+// A translated block always runs to completion, so CPU::run may overshoot
+// its cycle target by up to one block (BlockCache::MAX_BLOCK_LEN cycles).
+//
+// Only available on x86-64 hosts; available() is false elsewhere.
+
+class Jit {
+public:
+    static constexpr uint32_t HOT_THRESHOLD = 16;
+    static constexpr size_t CODE_SIZE = 16 * 1024 * 1024;
+
+    // Host entry point: takes the guest register file, returns next PC
+    using BlockFn = uint32_t (*)(uint32_t* regs);
+
+    struct Block {
+        BlockFn fn = nullptr;
+        uint32_t count = 0;  // Guest instructions (= cycles) executed
+        uint32_t hits = 0;   // Entries seen by the interpreter so far
+    };
+
+    explicit Jit(Bus* bus);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    static bool available();
+
+    // Drop all translations and set the translatable range [0, code_end)
+    void reset(uint32_t code_end);
+
+    // Count an entry into the predecoded block at pc and translate it once
+    // hot. Returns the translation, or nullptr if the block should be
+    // interpreted this time.
+    const Block* enter(uint32_t pc, const DecodedInst* insts, uint32_t count) {
+        Block& b = blocks_[pc >> 1];
+        if (__builtin_expect(b.fn != nullptr, 1)) return &b;
+        if (++b.hits < HOT_THRESHOLD) return nullptr;
+        return translate(pc, insts, count);
+    }
+
+    // Statistics
+    size_t translated_blocks() const { return translated_; }
+    size_t code_bytes() const { return code_used_; }
+
+private:
+    Bus* bus_;
+    uint8_t* code_ = nullptr;
+    size_t code_used_ = 0;
+    size_t translated_ = 0;
+    std::vector<Block> blocks_;
+
+    const Block* translate(uint32_t pc, const DecodedInst* insts, uint32_t count);
+};
+
+} // namespace cosmo
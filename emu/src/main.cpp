@@ -6,6 +6,11 @@
 
 #include "cpu.hpp"
 #include "bus.hpp"
+#include "jit.hpp"
+#include "fastmem.hpp"
+#include "pixel.hpp"
+#include "scheduler.hpp"
+#include "triple_buffer.hpp"
 #include "device/memory.hpp"
 #include "device/usart.hpp"
 #include "device/timer.hpp"
@@ -13,17 +18,24 @@
 #include "device/dma.hpp"
 #include "device/fsmc.hpp"
 #include "device/display.hpp"
+#include "device/blitter.hpp"
 #include "device/i2s.hpp"
 #include "device/eth.hpp"
 #include "device/hostclock.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -47,6 +59,8 @@ constexpr uint32_t DMA1_BASE    = 0x40020000;
 constexpr uint32_t DMA1_SIZE    = 0x1000;
 constexpr uint32_t DISPLAY_BASE = 0x40018000;
 constexpr uint32_t DISPLAY_SIZE = 0x100;
+constexpr uint32_t BLITTER_BASE = 0x40019000;
+constexpr uint32_t BLITTER_SIZE = 0x100;
 constexpr uint32_t FSMC_BASE    = 0x60000000;
 constexpr uint32_t FSMC_SIZE    = 0x100000;  // 1MB
 constexpr uint32_t I2S_BASE     = 0x40013000;
@@ -56,6 +70,12 @@ constexpr uint32_t ETH_SIZE       = 0x1000;
 constexpr uint32_t HOSTCLOCK_BASE = 0xE0001000;
 constexpr uint32_t HOSTCLOCK_SIZE = 0x100;
 
+// Global options (set from the command line)
+bool use_jit = false;
+bool use_fastmem = false;
+bool use_bitmanip = false;
+bool use_turbo = false;
+
 // Emulator context - centralizes device setup
 struct EmulatorContext {
     cosmo::ROM flash{FLASH_SIZE};
@@ -66,11 +86,15 @@ struct EmulatorContext {
     cosmo::DMA dma1;
     cosmo::FSMC fsmc;
     cosmo::DisplayControl display;
+    cosmo::Blitter blitter;
     cosmo::I2S i2s;
     cosmo::ETH eth;
     cosmo::HostClock hostclock;
     cosmo::Bus bus;
     cosmo::CPU cpu{&bus};
+    cosmo::Scheduler scheduler{&cpu.cycles};
+    std::unique_ptr<cosmo::Jit> jit;
+    std::unique_ptr<cosmo::Fastmem> fastmem;
 
     EmulatorContext() {
         // Map all devices
@@ -81,6 +105,7 @@ struct EmulatorContext {
         bus.map(PFIC_BASE, PFIC_SIZE, &pfic);
         bus.map(DMA1_BASE, DMA1_SIZE, &dma1);
         bus.map(DISPLAY_BASE, DISPLAY_SIZE, &display);
+        bus.map(BLITTER_BASE, BLITTER_SIZE, &blitter);
         bus.map(FSMC_BASE, FSMC_SIZE, &fsmc);
         bus.map(I2S_BASE, I2S_SIZE, &i2s);
         bus.map(ETH_BASE, ETH_SIZE, &eth);
@@ -89,13 +114,32 @@ struct EmulatorContext {
         // Fast-path for frequent memory regions (direct data pointers)
         bus.set_fast_path(flash.data(), FLASH_SIZE,
                           sram.data(), SRAM_BASE, SRAM_SIZE);
+        bus.map_memory(FSMC_BASE, FSMC_SIZE, fsmc.data(), true);
+
+        // Framebuffer dirty tracking (first write per page since last frame).
+        // The whole SRAM is watched since the display base can move.
+        bus.watch_writes(FSMC_BASE, FSMC_SIZE,
+                         [this](uint32_t addr) { fsmc.mark_dirty(addr - FSMC_BASE); });
+
+        // Optional reserved guest address space (MMIO through page faults)
+        if (use_fastmem) {
+            fastmem = std::make_unique<cosmo::Fastmem>();
+            if (!bus.set_fastmem(fastmem.get())) {
+                std::fprintf(stderr, "Warning: fastmem setup failed, using page table\n");
+            }
+        }
 
         // DMA needs bus access for transfers
         dma1.set_bus_callbacks(
             [this](uint32_t addr, cosmo::Width w) { return bus.read(addr, w); },
-            [this](uint32_t addr, cosmo::Width w, uint32_t val) { bus.write(addr, w, val); }
+            [this](uint32_t addr, cosmo::Width w, uint32_t val) { bus.write(addr, w, val); },
+            [this](uint32_t addr, uint32_t len, bool write) { return bus.memory_span(addr, len, write); }
         );
 
+        // The blitter works on host memory only
+        blitter.set_bus_callbacks(
+            [this](uint32_t addr, uint32_t len, bool write) { return bus.memory_span(addr, len, write); });
+
         // ETH needs bus access for DMA descriptors
         eth.set_bus_callbacks(
             [this](uint32_t addr, cosmo::Width w) { return bus.read(addr, w); },
@@ -103,9 +147,35 @@ struct EmulatorContext {
         );
         eth.set_tftp_root("fs");
 
+        // DMA request lines (channel assignment as on the CH32V307, lines
+        // sharing a channel are OR'ed)
+        dma1.connect_request(cosmo::I2S_DMA_CH, [this] { return i2s.dma_request(); });
+        dma1.connect_request(cosmo::USART::DMA_TX_CH, [this] { return usart1.dma_tx_request(); });
+        dma1.connect_request(cosmo::USART::DMA_RX_CH, [this] { return usart1.dma_rx_request(); });
+        i2s.set_dma_notify([this] { dma1.request_changed(); });
+        usart1.set_dma_notify([this] { dma1.request_changed(); });
+
+        // Devices post their next event; the CPU runs up to the earliest
+        systick.set_event_slot({&scheduler, scheduler.add(&systick)});
+        dma1.set_event_slot({&scheduler, scheduler.add(&dma1)});
+        i2s.set_event_slot({&scheduler, scheduler.add(&i2s)});
+        display.set_event_slot({&scheduler, scheduler.add(&display)});
+        blitter.set_event_slot({&scheduler, scheduler.add(&blitter)});
+        eth.set_event_slot({&scheduler, scheduler.add(&eth)});
+        cpu.set_scheduler(&scheduler);
+
         // Connect CPU to PFIC
         cpu.set_pfic(&pfic);
 
+        // Optional JIT backend for CPU::run
+        if (use_jit) {
+            jit = std::make_unique<cosmo::Jit>(&bus);
+            cpu.set_jit(jit.get());
+        }
+
+        // Optional Zba/Zbb/Zbs (not implemented by the CH32V307)
+        if (use_bitmanip) cpu.set_bitmanip(true);
+
         // Connect USART to PFIC for RX interrupts
         usart1.set_pfic(&pfic);
     }
@@ -119,19 +189,42 @@ struct EmulatorContext {
         return true;
     }
 
-    // Tick all peripherals and handle interrupts
-    void tick_peripherals() {
-        if (auto irq = systick.tick(cpu.cycles)) {
-            pfic.set_pending(irq->cause);
-            cpu.mip |= cosmo::MIE_MEIE;
-        }
-        if (auto irq = dma1.tick(cpu.cycles)) {
-            pfic.set_pending(irq->cause);
-            cpu.mip |= cosmo::MIE_MEIE;
-        }
-        if (auto irq = eth.tick(cpu.cycles)) {
-            pfic.set_pending(irq->cause);
+    // Framebuffer contents or display settings changed since the last call
+    bool take_display_changed() {
+        // Only the displayed frame is re-armed; a move of the base counts
+        // as a change by itself, and re-arms the new frame on the next call
+        bool changed = fsmc.take_dirty(display.fb_base(), cosmo::DisplayControl::FRAME_BYTES);
+        changed |= display.take_changed();
+        bus.rearm_watch(FSMC_BASE + display.fb_base(), cosmo::DisplayControl::FRAME_BYTES);
+        return changed;
+    }
+
+    // Tick the peripherals whose events are due and handle interrupts
+    void service_events() {
+        scheduler.run_due(cpu.cycles, [this](cosmo::Interrupt irq) {
+            pfic.set_pending(irq.cause);
             cpu.mip |= cosmo::MIE_MEIE;
+        });
+    }
+
+    // Run the CPU up to target, stopping at every device event on the way.
+    // While waiting for an interrupt, time skips straight to the next event.
+    // Returns early on ECALL.
+    void run_until(uint64_t target) {
+        while (cpu.cycles < target && !cpu.halted) {
+            if (cpu.wfi) {
+                cpu.idle(std::min(target, scheduler.next()));
+                service_events();
+                cpu.check_interrupts();
+                continue;
+            }
+
+            cpu.run(target);
+            service_events();
+
+            if (cpu.mcause == static_cast<uint32_t>(cosmo::TrapCause::ECallFromMMode)) {
+                break;
+            }
         }
     }
 };
@@ -151,7 +244,9 @@ TestResult check_test_result(cosmo::CPU& cpu) {
 // Test runner
 std::string usart_output;
 
-bool run_test(const char* path, bool verbose) {
+// batch drives CPU::run() instead of CPU::step(), so the predecoded block
+// loop (and its threaded dispatch) is covered by the same tests
+bool run_test(const char* path, bool verbose, bool batch = false) {
     EmulatorContext emu;
 
     // Capture USART output
@@ -163,27 +258,33 @@ bool run_test(const char* path, bool verbose) {
     constexpr uint64_t MAX_CYCLES = 100'000'000;
 
     while (emu.cpu.cycles < MAX_CYCLES && !emu.cpu.halted) {
-        emu.tick_peripherals();
+        emu.service_events();
 
         // Handle WFI - check for pending interrupts to wake
         if (emu.cpu.wfi) {
             emu.cpu.check_interrupts();
             if (emu.cpu.wfi) {
-                // Still waiting - increment cycles to avoid infinite loop
-                emu.cpu.cycles++;
+                // Still waiting - skip ahead to the next device event
+                emu.cpu.idle(std::max(emu.cpu.cycles + 1,
+                                      std::min(MAX_CYCLES, emu.scheduler.next())));
                 continue;
             }
         }
 
-        emu.cpu.step();
+        // The JIT only runs in batch mode: execute one block at a time
+        if (batch || emu.jit) {
+            emu.cpu.run(emu.cpu.cycles + 1);
+        } else {
+            emu.cpu.step();
+        }
 
         TestResult result = check_test_result(emu.cpu);
         if (result == TestResult::Pass) {
-            if (verbose) std::printf("PASS: %s\n", path);
+            if (verbose) std::printf("PASS: %s%s\n", path, batch ? " [run]" : "");
             return true;
         } else if (result == TestResult::Fail) {
             uint32_t test_num = emu.cpu.reg(3) >> 1;
-            std::printf("FAIL: %s (test #%u)\n", path, test_num);
+            std::printf("FAIL: %s%s (test #%u)\n", path, batch ? " [run]" : "", test_num);
             if (!usart_output.empty()) {
                 std::printf("USART output: %s\n", usart_output.c_str());
             }
@@ -196,11 +297,11 @@ bool run_test(const char* path, bool verbose) {
     }
 
     if (emu.cpu.cycles >= MAX_CYCLES) {
-        std::printf("TIMEOUT: %s\n", path);
+        std::printf("TIMEOUT: %s%s\n", path, batch ? " [run]" : "");
         return false;
     }
 
-    std::printf("UNKNOWN: %s (halted without ECALL)\n", path);
+    std::printf("UNKNOWN: %s%s (halted without ECALL)\n", path, batch ? " [run]" : "");
     return false;
 }
 
@@ -230,6 +331,13 @@ bool run_tests(const char* dir_path) {
         } else {
             failed++;
         }
+        // With --jit every run already goes through CPU::run()
+        if (use_jit) continue;
+        if (run_test(path.string().c_str(), true, true)) {
+            passed++;
+        } else {
+            failed++;
+        }
     }
 
     std::printf("\n=== Results ===\n");
@@ -240,13 +348,6 @@ bool run_tests(const char* dir_path) {
     return failed == 0;
 }
 
-// RGB565 to RGB888 conversion
-inline void rgb565_to_rgb888(uint16_t c, uint8_t& r, uint8_t& g, uint8_t& b) {
-    r = ((c >> 11) & 0x1F) << 3;
-    g = ((c >> 5) & 0x3F) << 2;
-    b = (c & 0x1F) << 3;
-}
-
 // Audio callback - called by SDL from audio thread
 void audio_callback(void* userdata, Uint8* stream, int len) {
     auto* i2s = static_cast<cosmo::I2S*>(userdata);
@@ -261,50 +362,97 @@ void audio_callback(void* userdata, Uint8* stream, int len) {
     }
 }
 
+// Display state as seen by the renderer, published by the emulation thread
+// whenever the framebuffer or display settings change. The frame is stored
+// in display order (base and scroll already applied).
+struct FrameSnapshot {
+    std::vector<uint8_t> fb;
+    cosmo::pixel::Palette palette{};
+    cosmo::DisplayMode mode = cosmo::DisplayMode::Mode0_640x400x4bpp;
+    int width = 0;
+    int height = 0;
+
+    void capture(const cosmo::FSMC& fsmc, const cosmo::DisplayControl& display) {
+        palette = display.palette();
+        mode = display.mode();
+        width = display.width();
+        height = display.height();
+        size_t stride = cosmo::DisplayControl::FRAME_BYTES / height;
+        fb.resize(cosmo::DisplayControl::FRAME_BYTES);
+        for (int y = 0; y < height; y++) {
+            std::memcpy(fb.data() + y * stride, fsmc.data() + display.row_offset(y), stride);
+        }
+    }
+};
+
 // Render framebuffer to SDL texture
-void render_framebuffer(SDL_Texture* texture, const cosmo::FSMC& fsmc,
-                        const cosmo::DisplayControl& display) {
+void render_framebuffer(SDL_Texture* texture, const FrameSnapshot& frame) {
     void* pixels;
     int pitch;
 
     if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) return;
 
-    auto* dst = static_cast<uint32_t*>(pixels);
-    const uint8_t* fb = fsmc.framebuffer();
-    const auto& palette = display.palette();
-    int w = display.width();
-    int h = display.height();
+    auto* dst = static_cast<uint8_t*>(pixels);
+    const uint8_t* fb = frame.fb.data();
+    int w = frame.width;
+    int h = frame.height;
+    cosmo::pixel::Kernel k = cosmo::pixel::best();
+
+    for (int y = 0; y < h; y++) {
+        auto* row = reinterpret_cast<uint32_t*>(dst + y * pitch);
+        if (frame.mode == cosmo::DisplayMode::Mode0_640x400x4bpp) {
+            // 4bpp indexed: 2 pixels per byte
+            cosmo::pixel::expand_4bpp(k, row, fb + y * w / 2, w, frame.palette);
+        } else {
+            // 16bpp RGB565 direct
+            cosmo::pixel::convert_rgb565(k, row, reinterpret_cast<const uint16_t*>(fb) + y * w, w);
+        }
+    }
 
-    if (display.mode() == cosmo::DisplayMode::Mode0_640x400x4bpp) {
-        // 4bpp indexed: 2 pixels per byte
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x += 2) {
-                uint8_t byte = fb[(y * w + x) / 2];
-                uint8_t idx0 = byte & 0x0F;
-                uint8_t idx1 = (byte >> 4) & 0x0F;
+    SDL_UnlockTexture(texture);
+}
 
-                uint8_t r, g, b;
-                rgb565_to_rgb888(palette[idx0], r, g, b);
-                dst[y * (pitch / 4) + x] = (r << 16) | (g << 8) | b;
+// Keyboard input, handed from the SDL thread to the emulation thread
+class HostInput {
+public:
+    void queue(const char* text) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            text_ += text;
+        }
+        cv_.notify_one();
+    }
 
-                rgb565_to_rgb888(palette[idx1], r, g, b);
-                dst[y * (pitch / 4) + x + 1] = (r << 16) | (g << 8) | b;
-            }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
         }
-    } else {
-        // 16bpp RGB565 direct
-        const auto* fb16 = reinterpret_cast<const uint16_t*>(fb);
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                uint8_t r, g, b;
-                rgb565_to_rgb888(fb16[y * w + x], r, g, b);
-                dst[y * (pitch / 4) + x] = (r << 16) | (g << 8) | b;
-            }
+        cv_.notify_one();
+    }
+
+    // Move queued input to the USART, false once stopped
+    bool forward(cosmo::USART& usart) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!text_.empty()) {
+            usart.queue_input(text_.c_str());
+            text_.clear();
         }
+        return !stop_;
     }
 
-    SDL_UnlockTexture(texture);
-}
+    // Block until input arrives, stop() is called or the timeout expires
+    void wait(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, timeout, [this] { return !text_.empty() || stop_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string text_;
+    bool stop_ = false;
+};
 
 // Interactive emulator with SDL
 void run_emulator(const char* firmware_path) {
@@ -388,6 +536,7 @@ void run_emulator(const char* firmware_path) {
         std::fprintf(stderr, "SDL_OpenAudioDevice failed: %s\n", SDL_GetError());
     } else {
         SDL_PauseAudioDevice(audio_dev, 0);  // Start playback
+        emu.i2s.set_host_drain(true);        // SDL callback consumes samples
     }
 
     std::printf("COSMO-32 Emulator\n");
@@ -400,13 +549,78 @@ void run_emulator(const char* firmware_path) {
 
     constexpr uint64_t CYCLES_PER_FRAME = 144'000'000 / 60;
     constexpr uint32_t FRAME_TIME_MS = 1000 / 60;  // ~16ms for 60fps
+    constexpr uint64_t CYCLES_PER_MS = 144'000;
+    constexpr uint64_t IDLE_WAIT_MS = 500;         // Upper bound for blocking
 
-    bool running = true;
-    while (running && !emu.cpu.halted) {
-        uint32_t frame_start = SDL_GetTicks();
+    // The emulation runs on its own thread; this one owns SDL, forwards
+    // keyboard input and renders the display snapshots it publishes
+    auto frames = std::make_unique<cosmo::TripleBuffer<FrameSnapshot>>();
+    HostInput input;
+    std::atomic<bool> emu_done{false};
 
+    std::thread emu_thread([&] {
+        using Clock = std::chrono::steady_clock;
+        const auto frame_time = std::chrono::microseconds(1'000'000 / 60);
+        auto frame_deadline = Clock::now();
+
+        while (!emu.cpu.halted) {
+            if (!input.forward(emu.usart1)) break;
+
+            // Run CPU for one frame worth of cycles (144 MHz / 60 FPS = 2.4M cycles)
+            emu.run_until(emu.cpu.cycles + CYCLES_PER_FRAME);
+            if (emu.cpu.mcause == static_cast<uint32_t>(cosmo::TrapCause::ECallFromMMode)) {
+                std::printf("\nECALL at PC=0x%08X, a0=%u\n", emu.cpu.mepc, emu.cpu.reg(10));
+                emu.cpu.halted = true;
+            }
+
+            // Publish the display (copy only if something changed)
+            if (emu.take_display_changed()) {
+                frames->back().capture(emu.fsmc, emu.display);
+                frames->publish();
+            }
+
+            if (use_turbo) continue;
+
+            // Idle (WFI, no input): block until host input or the next device
+            // event. Guest time keeps pace with the host clock while blocked.
+            if (emu.cpu.wfi && !emu.usart1.has_input()) {
+                uint64_t wait_ms = IDLE_WAIT_MS;
+                uint64_t next_event = emu.scheduler.next();
+                if (next_event != cosmo::Scheduler::NEVER) {
+                    uint64_t ahead = next_event > emu.cpu.cycles ? next_event - emu.cpu.cycles : 0;
+                    wait_ms = std::min(wait_ms, ahead / CYCLES_PER_MS);
+                }
+                auto idle_start = Clock::now();
+                input.wait(std::chrono::milliseconds(wait_ms));
+                auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - idle_start);
+                emu.run_until(emu.cpu.cycles + idle.count() * CYCLES_PER_MS);
+                frame_deadline = Clock::now();
+                continue;
+            }
+
+            // Frame timing - sleep to maintain 60fps, without catching up
+            // on frames that ran late
+            frame_deadline += frame_time;
+            auto now = Clock::now();
+            if (frame_deadline > now) {
+                std::this_thread::sleep_until(frame_deadline);
+            } else {
+                frame_deadline = now;
+            }
+        }
+        emu_done = true;
+    });
+
+    SDL_Texture* active_tex = tex_mode0;
+    bool running = true;
+    while (running && !emu_done) {
+        // Present new frames as they come (vsync paces this loop), wait for
+        // events while nothing changes
+        bool fresh = frames->update();
+        bool redraw = fresh;
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        bool have_event = redraw ? SDL_PollEvent(&event) : SDL_WaitEventTimeout(&event, FRAME_TIME_MS);
+        while (have_event) {
             switch (event.type) {
                 case SDL_QUIT:
                     running = false;
@@ -416,57 +630,38 @@ void run_emulator(const char* firmware_path) {
                     if (event.key.keysym.sym == SDLK_ESCAPE) {
                         running = false;
                     } else if (event.key.keysym.sym == SDLK_RETURN) {
-                        emu.usart1.queue_input("\n");
+                        input.queue("\n");
                     } else if (event.key.keysym.sym == SDLK_BACKSPACE) {
-                        emu.usart1.queue_input("\b");
+                        input.queue("\b");
                     }
                     break;
 
                 case SDL_TEXTINPUT:
-                    emu.usart1.queue_input(event.text.text);
+                    input.queue(event.text.text);
                     break;
-            }
-        }
-
-        // Run CPU for one frame worth of cycles (144 MHz / 60 FPS = 2.4M cycles)
-        uint64_t target = emu.cpu.cycles + CYCLES_PER_FRAME;
-        while (emu.cpu.cycles < target && !emu.cpu.halted && !emu.cpu.wfi) {
-            uint64_t batch = std::min<uint64_t>(emu.cpu.cycles + 10000ULL, target);
-            emu.cpu.run(batch);
-            emu.tick_peripherals();
 
-            if (emu.cpu.mcause == static_cast<uint32_t>(cosmo::TrapCause::ECallFromMMode)) {
-                std::printf("\nECALL at PC=0x%08X, a0=%u\n", emu.cpu.mepc, emu.cpu.reg(10));
-                emu.cpu.halted = true;
-                break;
+                case SDL_WINDOWEVENT:
+                    redraw = true;
+                    break;
             }
-        }
-        // If CPU is waiting for interrupt, tick peripherals and check for wakeup
-        if (emu.cpu.wfi) {
-            emu.tick_peripherals();
-            emu.cpu.check_interrupts();
+            have_event = SDL_PollEvent(&event);
         }
 
-        // Render display
-        SDL_Texture* active_tex = (emu.display.mode() == cosmo::DisplayMode::Mode0_640x400x4bpp)
-                                  ? tex_mode0 : tex_mode1;
-        render_framebuffer(active_tex, emu.fsmc, emu.display);
+        if (!redraw) continue;
+        const FrameSnapshot& frame = frames->front();
+        if (fresh) {
+            active_tex = (frame.mode == cosmo::DisplayMode::Mode0_640x400x4bpp) ? tex_mode0 : tex_mode1;
+            render_framebuffer(active_tex, frame);
+        }
 
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, active_tex, nullptr, nullptr);
         SDL_RenderPresent(renderer);
-
-        // Frame timing - sleep to maintain 60fps (or longer if idle)
-        uint32_t frame_time = SDL_GetTicks() - frame_start;
-        uint32_t sleep_time = FRAME_TIME_MS;
-        if (emu.cpu.wfi && !emu.usart1.has_input()) {
-            sleep_time = 100;  // Sleep longer when idle (100ms)
-        }
-        if (frame_time < sleep_time) {
-            SDL_Delay(sleep_time - frame_time);
-        }
     }
 
+    input.stop();
+    emu_thread.join();
+
     std::printf("Emulator stopped after %lu cycles\n", static_cast<unsigned long>(emu.cpu.cycles));
 
     // Cleanup
@@ -488,45 +683,75 @@ void save_screenshot(const char* path, const cosmo::FSMC& fsmc, const cosmo::Dis
 
     int w = display.width();
     int h = display.height();
-    const uint8_t* fb = fsmc.framebuffer();
-    const auto& palette = display.palette();
+    cosmo::pixel::Kernel k = cosmo::pixel::best();
 
     std::fprintf(f, "P6\n%d %d\n255\n", w, h);
 
-    if (display.mode() == cosmo::DisplayMode::Mode0_640x400x4bpp) {
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                int byte_offset = (y * w + x) / 2;
-                uint8_t byte = fb[byte_offset];
-                uint8_t idx = (x & 1) ? ((byte >> 4) & 0x0F) : (byte & 0x0F);
-                uint16_t c = palette[idx];
-                uint8_t r = ((c >> 11) & 0x1F) << 3;
-                uint8_t g = ((c >> 5) & 0x3F) << 2;
-                uint8_t b = (c & 0x1F) << 3;
-                std::fputc(r, f);
-                std::fputc(g, f);
-                std::fputc(b, f);
-            }
+    // Convert a row at a time, then pack XRGB8888 to RGB
+    std::vector<uint32_t> xrgb(w);
+    std::vector<uint8_t> rgb(w * 3);
+    for (int y = 0; y < h; y++) {
+        const uint8_t* row = fsmc.data() + display.row_offset(y);
+        if (display.mode() == cosmo::DisplayMode::Mode0_640x400x4bpp) {
+            cosmo::pixel::expand_4bpp(k, xrgb.data(), row, w, display.palette());
+        } else {
+            cosmo::pixel::convert_rgb565(k, xrgb.data(), reinterpret_cast<const uint16_t*>(row), w);
         }
-    } else {
-        const auto* fb16 = reinterpret_cast<const uint16_t*>(fb);
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                uint16_t c = fb16[y * w + x];
-                uint8_t r = ((c >> 11) & 0x1F) << 3;
-                uint8_t g = ((c >> 5) & 0x3F) << 2;
-                uint8_t b = (c & 0x1F) << 3;
-                std::fputc(r, f);
-                std::fputc(g, f);
-                std::fputc(b, f);
-            }
+        for (int x = 0; x < w; x++) {
+            rgb[x * 3 + 0] = static_cast<uint8_t>(xrgb[x] >> 16);
+            rgb[x * 3 + 1] = static_cast<uint8_t>(xrgb[x] >> 8);
+            rgb[x * 3 + 2] = static_cast<uint8_t>(xrgb[x]);
         }
+        std::fwrite(rgb.data(), 1, rgb.size(), f);
     }
 
     std::fclose(f);
     std::fprintf(stderr, "Screenshot saved: %s\n", path);
 }
 
+// Pixel conversion micro-benchmark: Mpixels/s of every kernel the host
+// supports, for a full 640x400 frame in each display mode
+bool bench_pixels() {
+    constexpr size_t PIXELS = 640 * 400;
+    constexpr int FRAMES = 200;
+    using cosmo::pixel::Kernel;
+
+    std::vector<uint8_t> fb4(PIXELS / 2);
+    std::vector<uint16_t> fb16(PIXELS);
+    uint32_t seed = 1;
+    for (auto& b : fb4) b = static_cast<uint8_t>((seed = seed * 1103515245 + 12345) >> 16);
+    for (auto& p : fb16) p = static_cast<uint16_t>((seed = seed * 1103515245 + 12345) >> 16);
+    cosmo::pixel::Palette palette;
+    for (size_t i = 0; i < palette.size(); i++) palette[i] = static_cast<uint16_t>(i * 0x1111);
+
+    std::vector<uint32_t> ref4(PIXELS), ref16(PIXELS), out(PIXELS);
+    cosmo::pixel::expand_4bpp(Kernel::Scalar, ref4.data(), fb4.data(), PIXELS, palette);
+    cosmo::pixel::convert_rgb565(Kernel::Scalar, ref16.data(), fb16.data(), PIXELS);
+
+    auto measure = [&](auto&& convert) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < FRAMES; i++) convert();
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+        return PIXELS * FRAMES / t.count() / 1e6;
+    };
+
+    bool ok = true;
+    std::printf("%-8s %14s %14s\n", "kernel", "4bpp Mpix/s", "rgb565 Mpix/s");
+    for (int i = 0; i < static_cast<int>(Kernel::Count); i++) {
+        Kernel k = static_cast<Kernel>(i);
+        if (!cosmo::pixel::supported(k)) continue;
+        double m4 = measure([&] { cosmo::pixel::expand_4bpp(k, out.data(), fb4.data(), PIXELS, palette); });
+        bool ok4 = out == ref4;
+        double m16 = measure([&] { cosmo::pixel::convert_rgb565(k, out.data(), fb16.data(), PIXELS); });
+        bool ok16 = out == ref16;
+        std::printf("%-8s %14.1f %14.1f%s%s\n", cosmo::pixel::name(k), m4, m16,
+                    k == cosmo::pixel::best() ? "  (used)" : "",
+                    ok4 && ok16 ? "" : "  MISMATCH");
+        ok = ok && ok4 && ok16;
+    }
+    return ok;
+}
+
 // Headless mode
 void run_headless(const char* firmware_path, const char* input_str = nullptr,
                    uint64_t timeout_ms = 0, bool batch_mode = false, const char* screenshot_path = nullptr) {
@@ -560,16 +785,7 @@ void run_headless(const char* firmware_path, const char* input_str = nullptr,
     auto start = std::chrono::steady_clock::now();
     uint64_t start_cycles = emu.cpu.cycles;
 
-    constexpr uint64_t PERIPHERAL_TICK_INTERVAL = 10000;
-    while (emu.cpu.cycles < max_cycles && !emu.cpu.halted) {
-        uint64_t batch_target = std::min(emu.cpu.cycles + PERIPHERAL_TICK_INTERVAL, max_cycles);
-        emu.cpu.run(batch_target);
-        emu.tick_peripherals();
-
-        if (emu.cpu.mcause == static_cast<uint32_t>(cosmo::TrapCause::ECallFromMMode)) {
-            break;
-        }
-    }
+    emu.run_until(max_cycles);
 
     auto end = std::chrono::steady_clock::now();
     auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -579,6 +795,10 @@ void run_headless(const char* firmware_path, const char* input_str = nullptr,
     std::fprintf(stderr, "Cycles: %lu, Time: %lu ms, MIPS: %.2f\n",
                  static_cast<unsigned long>(total_cycles),
                  static_cast<unsigned long>(duration_ms), mips);
+    if (emu.jit) {
+        std::fprintf(stderr, "JIT: %zu blocks, %zu KB code\n",
+                     emu.jit->translated_blocks(), emu.jit->code_bytes() / 1024);
+    }
 
     if (emu.cpu.cycles >= max_cycles && timeout_ms > 0) {
         std::fprintf(stderr, "Timeout after %lu ms\n", static_cast<unsigned long>(timeout_ms));
@@ -592,12 +812,48 @@ void run_headless(const char* firmware_path, const char* input_str = nullptr,
 } // anonymous namespace
 
 int main(int argc, char* argv[]) {
+    // Global options may appear anywhere; strip them before mode parsing
+    int nargs = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--jit") == 0) {
+            use_jit = true;
+        } else if (std::strcmp(argv[i], "--fastmem") == 0) {
+            use_fastmem = true;
+        } else if (std::strcmp(argv[i], "--bitmanip") == 0) {
+            use_bitmanip = true;
+        } else if (std::strcmp(argv[i], "--turbo") == 0) {
+            use_turbo = true;
+        } else {
+            argv[nargs++] = argv[i];
+        }
+    }
+    argc = nargs;
+
+    if (use_jit && !cosmo::Jit::available()) {
+        std::fprintf(stderr, "Warning: --jit is not supported on this host, using interpreter\n");
+        use_jit = false;
+    }
+    if (use_fastmem && !cosmo::Fastmem::available()) {
+        std::fprintf(stderr, "Warning: --fastmem is not supported on this host, ignoring\n");
+        use_fastmem = false;
+    }
+
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-pixels") == 0) {
+        return bench_pixels() ? 0 : 1;
+    }
+
     if (argc < 2) {
         std::fprintf(stderr, "COSMO-32 Emulator\n");
         std::fprintf(stderr, "Usage: cosmo32 <firmware.bin>\n");
         std::fprintf(stderr, "       cosmo32 --headless <firmware.bin> [options]\n");
         std::fprintf(stderr, "       cosmo32 --run-tests <test-dir>\n");
         std::fprintf(stderr, "       cosmo32 --test <test-file.bin>\n");
+        std::fprintf(stderr, "       cosmo32 --bench-pixels\n");
+        std::fprintf(stderr, "\nGlobal options:\n");
+        std::fprintf(stderr, "  --jit               Translate hot guest code to x86-64\n");
+        std::fprintf(stderr, "  --fastmem           Map guest memory 1:1, trap MMIO via page faults\n");
+        std::fprintf(stderr, "  --bitmanip          Enable Zba/Zbb/Zbs instructions (not on CH32V307)\n");
+        std::fprintf(stderr, "  --turbo             Interactive mode: run as fast as possible, not real time\n");
         std::fprintf(stderr, "\nHeadless options:\n");
         std::fprintf(stderr, "  --cmd <command>     Execute single command, then exit\n");
         std::fprintf(stderr, "  --timeout <ms>      Exit after timeout (milliseconds)\n");
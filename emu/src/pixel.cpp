@@ -0,0 +1,231 @@
+#include "pixel.hpp"
+
+#if defined(__x86_64__)
+#define COSMO_PIXEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cosmo {
+
+namespace pixel {
+
+namespace {
+
+void palette_xrgb(uint32_t* out, const Palette& palette) {
+    for (size_t i = 0; i < palette.size(); i++) out[i] = rgb565_to_xrgb(palette[i]);
+}
+
+void expand_4bpp_scalar(uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette) {
+    for (size_t i = 0; i < pixels; i += 2) {
+        uint8_t byte = src[i / 2];
+        dst[i] = rgb565_to_xrgb(palette[byte & 0x0F]);
+        dst[i + 1] = rgb565_to_xrgb(palette[byte >> 4]);
+    }
+}
+
+void expand_4bpp_table(uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette) {
+    if (!pixels) return;
+    uint32_t pal[16];
+    palette_xrgb(pal, palette);
+    uint64_t table[256];
+    for (uint32_t b = 0; b < 256; b++) {
+        table[b] = pal[b & 0x0F] | (static_cast<uint64_t>(pal[b >> 4]) << 32);
+    }
+    for (size_t i = 0; i < pixels / 2; i++) {
+        uint64_t two = table[src[i]];
+        dst[2 * i] = static_cast<uint32_t>(two);
+        dst[2 * i + 1] = static_cast<uint32_t>(two >> 32);
+    }
+}
+
+void convert_rgb565_scalar(uint32_t* dst, const uint16_t* src, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) dst[i] = rgb565_to_xrgb(src[i]);
+}
+
+#ifdef COSMO_PIXEL_X86
+
+// 32 pixels per step: the nibbles index byte planes of the palette
+__attribute__((target("ssse3")))
+void expand_4bpp_sse(uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette) {
+    uint32_t pal[16];
+    palette_xrgb(pal, palette);
+    alignas(16) uint8_t planes[3][16];
+    for (int i = 0; i < 16; i++) {
+        planes[0][i] = static_cast<uint8_t>(pal[i]);
+        planes[1][i] = static_cast<uint8_t>(pal[i] >> 8);
+        planes[2][i] = static_cast<uint8_t>(pal[i] >> 16);
+    }
+    const __m128i pb = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[0]));
+    const __m128i pg = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[1]));
+    const __m128i pr = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[2]));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t n = pixels & ~static_cast<size_t>(31);
+    for (size_t i = 0; i < n; i += 32) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i / 2));
+        __m128i lo = _mm_and_si128(bytes, nibble);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        __m128i idx[2] = {_mm_unpacklo_epi8(lo, hi), _mm_unpackhi_epi8(lo, hi)};
+        auto* out = reinterpret_cast<__m128i*>(dst + i);
+        for (int h = 0; h < 2; h++, out += 4) {
+            __m128i b = _mm_shuffle_epi8(pb, idx[h]);
+            __m128i g = _mm_shuffle_epi8(pg, idx[h]);
+            __m128i r = _mm_shuffle_epi8(pr, idx[h]);
+            __m128i bg_lo = _mm_unpacklo_epi8(b, g);
+            __m128i bg_hi = _mm_unpackhi_epi8(b, g);
+            __m128i r_lo = _mm_unpacklo_epi8(r, zero);
+            __m128i r_hi = _mm_unpackhi_epi8(r, zero);
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(bg_lo, r_lo));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, r_lo));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, r_hi));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, r_hi));
+        }
+    }
+    expand_4bpp_table(dst + n, src + n / 2, pixels - n, palette);
+}
+
+// 32 pixels per step, as the SSE kernel with 16 pixels per lane. The
+// unpacks work within 128-bit lanes, so results are recombined across
+// lanes before storing.
+__attribute__((target("avx2")))
+void expand_4bpp_avx2(uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette) {
+    uint32_t pal[16];
+    palette_xrgb(pal, palette);
+    alignas(16) uint8_t planes[3][16];
+    for (int i = 0; i < 16; i++) {
+        planes[0][i] = static_cast<uint8_t>(pal[i]);
+        planes[1][i] = static_cast<uint8_t>(pal[i] >> 8);
+        planes[2][i] = static_cast<uint8_t>(pal[i] >> 16);
+    }
+    const __m256i pb = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(planes[0])));
+    const __m256i pg = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(planes[1])));
+    const __m256i pr = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(planes[2])));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t n = pixels & ~static_cast<size_t>(31);
+    for (size_t i = 0; i < n; i += 32) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i / 2));
+        __m128i lo = _mm_and_si128(bytes, nibble);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        __m256i idx = _mm256_set_m128i(_mm_unpackhi_epi8(lo, hi), _mm_unpacklo_epi8(lo, hi));
+        __m256i b = _mm256_shuffle_epi8(pb, idx);
+        __m256i g = _mm256_shuffle_epi8(pg, idx);
+        __m256i r = _mm256_shuffle_epi8(pr, idx);
+        __m256i bg_lo = _mm256_unpacklo_epi8(b, g);
+        __m256i bg_hi = _mm256_unpackhi_epi8(b, g);
+        __m256i r_lo = _mm256_unpacklo_epi8(r, zero);
+        __m256i r_hi = _mm256_unpackhi_epi8(r, zero);
+        __m256i p0 = _mm256_unpacklo_epi16(bg_lo, r_lo);  // Pixels 0-3, 16-19
+        __m256i p1 = _mm256_unpackhi_epi16(bg_lo, r_lo);  // Pixels 4-7, 20-23
+        __m256i p2 = _mm256_unpacklo_epi16(bg_hi, r_hi);  // Pixels 8-11, 24-27
+        __m256i p3 = _mm256_unpackhi_epi16(bg_hi, r_hi);  // Pixels 12-15, 28-31
+        auto* out = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    expand_4bpp_table(dst + n, src + n / 2, pixels - n, palette);
+}
+
+// 8 pixels per step, SSE2 only
+void convert_rgb565_sse(uint32_t* dst, const uint16_t* src, size_t pixels) {
+    const __m128i mask_rb = _mm_set1_epi16(0xF8);
+    const __m128i mask_g = _mm_set1_epi16(0xFC);
+    size_t n = pixels & ~static_cast<size_t>(7);
+    for (size_t i = 0; i < n; i += 8) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i r = _mm_and_si128(_mm_srli_epi16(c, 8), mask_rb);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(c, 3), mask_g);
+        __m128i b = _mm_and_si128(_mm_slli_epi16(c, 3), mask_rb);
+        __m128i gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+        auto* out = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gb, r));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gb, r));
+    }
+    convert_rgb565_scalar(dst + n, src + n, pixels - n);
+}
+
+// 16 pixels per step. The unpacks work within 128-bit lanes, so the two
+// results are recombined across lanes before storing.
+__attribute__((target("avx2")))
+void convert_rgb565_avx2(uint32_t* dst, const uint16_t* src, size_t pixels) {
+    const __m256i mask_rb = _mm256_set1_epi16(0xF8);
+    const __m256i mask_g = _mm256_set1_epi16(0xFC);
+    size_t n = pixels & ~static_cast<size_t>(15);
+    for (size_t i = 0; i < n; i += 16) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi16(c, 8), mask_rb);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi16(c, 3), mask_g);
+        __m256i b = _mm256_and_si256(_mm256_slli_epi16(c, 3), mask_rb);
+        __m256i gb = _mm256_or_si256(_mm256_slli_epi16(g, 8), b);
+        __m256i lo = _mm256_unpacklo_epi16(gb, r);  // Pixels 0-3, 8-11
+        __m256i hi = _mm256_unpackhi_epi16(gb, r);  // Pixels 4-7, 12-15
+        auto* out = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    convert_rgb565_scalar(dst + n, src + n, pixels - n);
+}
+
+#endif
+
+} // anonymous namespace
+
+const char* name(Kernel k) {
+    switch (k) {
+        case Kernel::Scalar: return "scalar";
+        case Kernel::Table:  return "table";
+        case Kernel::SSE:    return "sse";
+        case Kernel::AVX2:   return "avx2";
+        default:             return "?";
+    }
+}
+
+bool supported(Kernel k) {
+    switch (k) {
+        case Kernel::Scalar:
+        case Kernel::Table:
+            return true;
+#ifdef COSMO_PIXEL_X86
+        case Kernel::SSE:  return __builtin_cpu_supports("ssse3");
+        case Kernel::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+Kernel best() {
+    static const Kernel k = supported(Kernel::AVX2) ? Kernel::AVX2
+                          : supported(Kernel::SSE)  ? Kernel::SSE
+                                                    : Kernel::Table;
+    return k;
+}
+
+void expand_4bpp(Kernel k, uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette) {
+    switch (k) {
+        case Kernel::Scalar: expand_4bpp_scalar(dst, src, pixels, palette); break;
+#ifdef COSMO_PIXEL_X86
+        case Kernel::SSE:    expand_4bpp_sse(dst, src, pixels, palette); break;
+        case Kernel::AVX2:   expand_4bpp_avx2(dst, src, pixels, palette); break;
+#endif
+        default:             expand_4bpp_table(dst, src, pixels, palette); break;
+    }
+}
+
+void convert_rgb565(Kernel k, uint32_t* dst, const uint16_t* src, size_t pixels) {
+    switch (k) {
+#ifdef COSMO_PIXEL_X86
+        case Kernel::SSE:  convert_rgb565_sse(dst, src, pixels); break;
+        case Kernel::AVX2: convert_rgb565_avx2(dst, src, pixels); break;
+#endif
+        default:           convert_rgb565_scalar(dst, src, pixels); break;
+    }
+}
+
+} // namespace pixel
+
+} // namespace cosmo
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace cosmo {
+
+// Framebuffer pixel conversion to host XRGB8888
+//
+// Two conversions cover both display modes: 4bpp indexed pixels (low nibble
+// first) through the 16-entry RGB565 palette, and RGB565 direct color.
+// Each has several kernels:
+//   Scalar - one pixel at a time, the reference
+//   Table  - 4bpp: 256-entry table mapping a byte to its two pixels, built
+//            per call from the palette; RGB565: same as Scalar
+//   SSE    - 4bpp: palette lookup with pshufb (SSSE3); RGB565: SSE2
+//   AVX2   - the SSE kernels on 256-bit vectors
+// best() picks the fastest one the host CPU supports. SIMD kernels are
+// only built for x86-64 and hand leftover pixels to the portable kernels;
+// all kernels produce identical output (cosmo32 --bench-pixels checks).
+//
+// RGB565 channels are widened by shifting (no low-bit replication).
+namespace pixel {
+
+using Palette = std::array<uint16_t, 16>;
+
+enum class Kernel { Scalar, Table, SSE, AVX2, Count };
+
+const char* name(Kernel k);
+bool supported(Kernel k);
+Kernel best();
+
+inline uint32_t rgb565_to_xrgb(uint16_t c) {
+    return ((c & 0xF800) << 8) | ((c & 0x07E0) << 5) | ((c & 0x001F) << 3);
+}
+
+// dst[0..pixels) from pixels / 2 bytes of src (pixels must be even)
+void expand_4bpp(Kernel k, uint32_t* dst, const uint8_t* src, size_t pixels, const Palette& palette);
+
+// dst[0..pixels) from src[0..pixels)
+void convert_rgb565(Kernel k, uint32_t* dst, const uint16_t* src, size_t pixels);
+
+} // namespace pixel
+
+} // namespace cosmo
@@ -0,0 +1,101 @@
+#pragma once
+#include "bus.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace cosmo {
+
+// Event scheduler for peripherals
+//
+// Devices that need time to pass (SysTick, DMA, I2S, Display, ETH) own a
+// slot and post the CPU cycle of their next event. The main loop runs the
+// CPU only up to next() and then ticks the devices that are due, so idle
+// devices cost nothing and events happen at their exact cycle instead of
+// at the end of a fixed batch.
+//
+// There are only a handful of event sources, so the earliest deadline is
+// cached and recomputed by a linear scan whenever a slot changes.
+
+class Scheduler {
+public:
+    static constexpr uint64_t NEVER = ~0ULL;
+
+    // clock: the CPU cycle counter (CPU::run publishes it before every
+    // device access, so MMIO handlers can read the exact cycle from now();
+    // translated JIT blocks publish it at block granularity)
+    explicit Scheduler(const uint64_t* clock) : clock_(clock) {}
+
+    uint64_t now() const { return *clock_; }
+
+    // Earliest pending event
+    uint64_t next() const { return next_; }
+
+    // Register an event source, returns its slot id
+    uint32_t add(Device* dev) {
+        slots_.push_back({dev, NEVER});
+        return static_cast<uint32_t>(slots_.size() - 1);
+    }
+
+    void schedule(uint32_t id, uint64_t cycle) {
+        slots_[id].deadline = cycle;
+        if (cycle < next_) {
+            next_ = cycle;
+        } else {
+            update_next();
+        }
+    }
+
+    // Tick every device whose event is due at `now` and pass the returned
+    // interrupts to on_irq. A device is unscheduled before its tick() and
+    // must post its next event from there; posting `now` again runs it
+    // again in the same call.
+    template <typename F>
+    void run_due(uint64_t now, F&& on_irq) {
+        while (next_ <= now) {
+            for (auto& s : slots_) {
+                if (s.deadline > now) continue;
+                s.deadline = NEVER;
+                update_next();
+                if (auto irq = s.device->tick(now)) {
+                    on_irq(*irq);
+                }
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        Device* device;
+        uint64_t deadline;
+    };
+
+    const uint64_t* clock_;
+    std::vector<Slot> slots_;
+    uint64_t next_ = NEVER;
+
+    void update_next() {
+        next_ = NEVER;
+        for (auto& s : slots_) next_ = std::min(next_, s.deadline);
+    }
+};
+
+// A device's handle on its scheduler slot. Unattached slots ignore all
+// requests, so devices also work standalone (tick() driven by hand).
+class EventSlot {
+public:
+    EventSlot() = default;
+    EventSlot(Scheduler* s, uint32_t id) : sched_(s), id_(id) {}
+
+    uint64_t now() const { return sched_ ? sched_->now() : 0; }
+
+    void schedule(uint64_t cycle) { if (sched_) sched_->schedule(id_, cycle); }
+    void schedule_now() { schedule(now()); }
+    void cancel() { schedule(Scheduler::NEVER); }
+
+private:
+    Scheduler* sched_ = nullptr;
+    uint32_t id_ = 0;
+};
+
+} // namespace cosmo
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace cosmo {
+
+// Lock-free triple buffer for handing whole values from one producer thread
+// to one consumer thread
+//
+// Each side owns one slot and the third is swapped between them through an
+// atomic index. Neither side ever waits: the producer overwrites a value
+// the consumer has not picked up yet, and the consumer always gets the
+// latest complete one.
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer: fill back(), then publish() it
+    T& back() { return slots_[back_]; }
+
+    void publish() {
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer: take the latest value if one was published since the last
+    // call (returns false otherwise); front() holds it
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    std::array<T, 3> slots_{};
+    uint8_t back_ = 0;
+    uint8_t front_ = 1;
+    std::atomic<uint8_t> middle_{2};
+};
+
+} // namespace cosmo
@@ -5,7 +5,7 @@
 //             FOR/TO/STEP/NEXT, WHILE/WEND, DIM, DATA/READ/RESTORE,
 //             ON...GOTO/GOSUB, REM, END, STOP
 // Graphics:   CLS, PSET x,y,c, LINE x1,y1,x2,y2,c, CIRCLE x,y,r,c,
-//             FCIRCLE x,y,r,c, PAINT x,y,fill,border
+//             FCIRCLE x,y,r,c, PAINT x,y,fill,border, FLIP
 // Commands:   RUN, LIST, NEW, LOAD, SAVE, BYE
 // Operators:  + - * / MOD, = <> < > <= >=, AND OR NOT
 // Functions:  ABS INT SGN RND, LEN VAL ASC, CHR$ STR$ LEFT$ RIGHT$ MID$
@@ -35,6 +35,8 @@ extern void display_fill_circle(int cx, int cy, int r, uint8_t color);
 extern void display_paint(int x, int y, uint8_t fill_color, uint8_t border_color);
 extern void display_set_cursor(int x, int y);
 extern void display_set_color(uint8_t fg, uint8_t bg);
+extern void display_flip(void);
+extern void display_single_buffer(void);
 
 //----------------------------------------------------------------------
 // Configuration
@@ -2117,6 +2119,12 @@ static void stmt_paint(void) {
     display_paint(x, y, (uint8_t)fill, (uint8_t)border);
 }
 
+// FLIP - show the frame drawn so far at the next VBlank, draw the next
+// one off screen (the program ending returns to drawing on screen)
+static void stmt_flip(void) {
+    display_flip();
+}
+
 // LOCATE row, col (1-based)
 static void stmt_locate(void) {
     skip_spaces();
@@ -2590,6 +2598,7 @@ static void execute_line(const char *line) {
         else if (match_keyword("CIRCLE")) stmt_circle();
         else if (match_keyword("FCIRCLE")) stmt_fcircle();
         else if (match_keyword("PAINT")) stmt_paint();
+        else if (match_keyword("FLIP")) stmt_flip();
         else if (match_keyword("LOCATE")) stmt_locate();
         else if (match_keyword("COLOR")) stmt_color();
         else if (match_keyword("RANDOMIZE")) stmt_randomize();
@@ -2650,6 +2659,7 @@ static void cmd_run(void) {
         if (!jump_pending) current_line++;
     }
     running = 0;
+    display_single_buffer();
 }
 
 static void cmd_new(void) {
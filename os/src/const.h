@@ -20,6 +20,7 @@
 #define FSMC_SIZE       0x00100000  // 1MB
 #define FRAMEBUF_OFFSET 0x000E0000  // 896KB offset
 #define FRAMEBUF_ADDR   (FSMC_BASE + FRAMEBUF_OFFSET)
+#define FRAMEBUF2_OFFSET 0x000B0000 // Second page, ends below BASIC_HEAP
 
 //----------------------------------------------------------------------
 // Peripherals
@@ -30,6 +31,7 @@
 #define TIM1_BASE       0x40012000
 #define I2S_BASE        0x40013000
 #define DISPLAY_BASE    0x40018000
+#define BLITTER_BASE    0x40019000
 #define DMA1_BASE       0x40020000
 #define ETH_BASE        0x40023000
 
@@ -89,8 +91,18 @@
 // Timer Registers (offset from TIMER_BASE)
 //----------------------------------------------------------------------
 
-#define TIMER_MTIME     0x00
-#define TIMER_MTIMECMP  0x08
+#define TIMER_CTRL      0x00
+#define TIMER_SR        0x04
+#define TIMER_CNT_L     0x08    // Counts CPU cycles while enabled
+#define TIMER_CNT_H     0x0C
+#define TIMER_CMP_L     0x10
+#define TIMER_CMP_H     0x14
+#define TIMER_RELOAD    0x18
+
+// TIMER_CTRL bits
+#define TIMER_CTRL_ENABLE   (1 << 0)
+
+#define TIMER_CYCLES_PER_MS 144000  // 144 MHz
 
 //----------------------------------------------------------------------
 // Host Clock Registers (offset from HOSTCLOCK_BASE)
@@ -144,12 +156,55 @@
 
 #define DISP_MODE       0x00
 #define DISP_STATUS     0x04
+#define DISP_SCROLL     0x08    // Vertical scroll in scanlines
+#define DISP_FBBASE     0x0C    // Framebuffer offset in FSMC SRAM
+#define DISP_CTRL       0x10
+#define DISP_FLIP       0x14    // Next DISP_FBBASE, taken at VBlank start
 #define DISP_PALETTE    0x40
 
 // Display modes
 #define DISP_MODE_640x400_4BPP   0
 #define DISP_MODE_320x200_16BPP  1
 
+// Status / control bits
+#define DISP_STATUS_VBLANK       (1 << 0)
+#define DISP_STATUS_FLIP_PENDING (1 << 1)
+#define DISP_CTRL_VBLANK_IE      (1 << 0)
+
+// Display VBlank IRQ number
+#define DISPLAY_VBLANK_IRQ      24
+
+//----------------------------------------------------------------------
+// Blitter Registers (offset from BLITTER_BASE)
+//----------------------------------------------------------------------
+
+#define BLIT_CMD        0x00    // Writing an OP starts the operation
+#define BLIT_STATUS     0x04
+#define BLIT_DST        0x08    // Destination surface address
+#define BLIT_DST_PITCH  0x0C    // Bytes per row
+#define BLIT_SRC        0x10    // Source surface / 1bpp bitmap address
+#define BLIT_SRC_PITCH  0x14
+#define BLIT_DST_XY     0x18    // x | y << 16 (pixels)
+#define BLIT_SRC_XY     0x1C
+#define BLIT_SIZE       0x20    // w | h << 16 (pixels)
+#define BLIT_COLOR      0x24    // fg | bg << 16
+
+// Command bits
+#define BLIT_OP_FILL    1
+#define BLIT_OP_COPY    2
+#define BLIT_OP_EXPAND  3
+#define BLIT_CMD_IE     (1 << 4)
+#define BLIT_CMD_FMT16  (1 << 5)    // RGB565 surfaces (default 4bpp)
+#define BLIT_CMD_TRANSP (1 << 6)    // EXPAND: skip 0 bits
+
+// Status bits
+#define BLIT_STATUS_BUSY (1 << 0)
+#define BLIT_STATUS_DONE (1 << 1)
+#define BLIT_STATUS_ERR  (1 << 2)
+
+// Blitter completion IRQ number
+#define BLIT_IRQ        27
+
 //----------------------------------------------------------------------
 // I2S Registers (offset from I2S_BASE)
 //----------------------------------------------------------------------
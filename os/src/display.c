@@ -1,5 +1,7 @@
 // COSMO-32 Display Driver
 // 640x400 @ 4bpp Terminal (80x50 characters)
+// Optional double buffering between two pages (display_flip)
+// Fills and text go through the blitter, single pixels through the CPU
 
 #include <stdint.h>
 #include "const.h"
@@ -18,14 +20,25 @@ static int cursor_x = 0;
 static int cursor_y = 0;
 static uint8_t fg_color = 15;  // White
 static uint8_t bg_color = 0;   // Black
+static int scroll_row = 0;     // Framebuffer text row shown at the top
+static uint32_t draw_page = FRAMEBUF_OFFSET;  // FSMC offset drawn to
+static uint32_t show_page = FRAMEBUF_OFFSET;  // FSMC offset displayed
 
 // Framebuffer pointer
 static volatile uint8_t *fb = (volatile uint8_t *)FRAMEBUF_ADDR;
 
 // Display control registers
 static volatile uint32_t *disp_mode = (volatile uint32_t *)(DISPLAY_BASE + DISP_MODE);
+static volatile uint32_t *disp_status = (volatile uint32_t *)(DISPLAY_BASE + DISP_STATUS);
+static volatile uint32_t *disp_scroll = (volatile uint32_t *)(DISPLAY_BASE + DISP_SCROLL);
+static volatile uint32_t *disp_flip = (volatile uint32_t *)(DISPLAY_BASE + DISP_FLIP);
 static volatile uint16_t *disp_palette = (volatile uint16_t *)(DISPLAY_BASE + DISP_PALETTE);
 
+// Blitter registers
+#define BLIT(reg) (*(volatile uint32_t *)(BLITTER_BASE + (reg)))
+
+static int blit_busy = 0;      // Blit started and not waited for yet
+
 // RGB565: RRRRR GGGGGG BBBBB
 static uint16_t make_rgb565(uint8_t r, uint8_t g, uint8_t b) {
     return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
@@ -56,11 +69,57 @@ void display_init(void) {
     display_clear();
 }
 
+// Framebuffer line of screen line y (the display wraps at the bottom)
+static int fb_line(int y) {
+    y += scroll_row * 8;
+    return y >= 400 ? y - 400 : y;
+}
+
+// Wait for the last blit; the CPU must not touch the framebuffer or start
+// another blit before it is done
+static void blit_wait(void) {
+    if (!blit_busy) return;
+    while (BLIT(BLIT_STATUS) & BLIT_STATUS_BUSY);
+    blit_busy = 0;
+}
+
+// Start a blit to framebuffer line fy. The registers are latched by the
+// command, so they are set up while the previous blit still runs.
+static void blit_start(uint32_t cmd, int x, int fy, int w, int h, uint32_t color) {
+    BLIT(BLIT_DST) = (uint32_t)fb;
+    BLIT(BLIT_DST_PITCH) = 320;
+    BLIT(BLIT_DST_XY) = x | (fy << 16);
+    BLIT(BLIT_SIZE) = w | (h << 16);
+    BLIT(BLIT_COLOR) = color;
+    blit_wait();
+    BLIT(BLIT_CMD) = cmd;
+    blit_busy = 1;
+}
+
+// Fill a screen rectangle (clipped), in two parts if it crosses the line
+// where the scrolled display wraps
+static void fill_rect(int x, int y, int w, int h, uint8_t color) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > 640) w = 640 - x;
+    if (y + h > 400) h = 400 - y;
+    if (w <= 0 || h <= 0) return;
+
+    int fy = fb_line(y);
+    int before_wrap = 400 - fy;
+    if (h > before_wrap) {
+        blit_start(BLIT_OP_FILL, x, 0, w, h - before_wrap, color);
+        h = before_wrap;
+    }
+    blit_start(BLIT_OP_FILL, x, fy, w, h, color);
+}
+
 // Set pixel at (x, y) to color index (0-15)
 void display_pset(int x, int y, uint8_t color) {
     if (x < 0 || x >= 640 || y < 0 || y >= 400) return;
+    blit_wait();
 
-    int byte_offset = (y * 640 + x) / 2;
+    int byte_offset = (fb_line(y) * 640 + x) / 2;
     uint8_t byte = fb[byte_offset];
 
     if (x & 1) {
@@ -74,8 +133,15 @@ void display_pset(int x, int y, uint8_t color) {
     fb[byte_offset] = byte;
 }
 
-// Draw line using Bresenham's algorithm
+// Draw line using Bresenham's algorithm (blitter fill if axis-aligned)
 void display_line(int x0, int y0, int x1, int y1, uint8_t color) {
+    if (x0 == x1 || y0 == y1) {
+        int x = x0 < x1 ? x0 : x1;
+        int y = y0 < y1 ? y0 : y1;
+        fill_rect(x, y, (x0 < x1 ? x1 - x0 : x0 - x1) + 1, (y0 < y1 ? y1 - y0 : y0 - y1) + 1, color);
+        return;
+    }
+
     int dx = x1 - x0;
     int dy = y1 - y0;
     int sx = dx >= 0 ? 1 : -1;
@@ -125,14 +191,12 @@ void display_circle(int cx, int cy, int r, uint8_t color) {
     }
 }
 
-// Draw filled circle
+// Draw filled circle, one blitter fill per line
 void display_fill_circle(int cx, int cy, int r, uint8_t color) {
     for (int y = -r; y <= r; y++) {
         int dx = 0;
         while (dx * dx + y * y <= r * r) dx++;
-        for (int x = -dx + 1; x < dx; x++) {
-            display_pset(cx + x, cy + y, color);
-        }
+        fill_rect(cx - dx + 1, cy + y, 2 * dx - 1, 1, color);
     }
 }
 
@@ -141,7 +205,8 @@ void display_paint(int x, int y, uint8_t fill_color, uint8_t border_color) {
     if (x < 0 || x >= 640 || y < 0 || y >= 400) return;
 
     // Get current pixel color
-    int byte_offset = (y * 640 + x) / 2;
+    blit_wait();
+    int byte_offset = (fb_line(y) * 640 + x) / 2;
     uint8_t byte = fb[byte_offset];
     uint8_t current = (x & 1) ? (byte >> 4) : (byte & 0x0F);
 
@@ -155,50 +220,33 @@ void display_paint(int x, int y, uint8_t fill_color, uint8_t border_color) {
     display_paint(x, y - 1, fill_color, border_color);
 }
 
-// Draw character at character position (col, row)
+// Draw character at character position (col, row): the blitter expands
+// the 1bpp glyph from the font in flash (text rows never cross the wrap)
 static void draw_char(int col, int row, char c, uint8_t fg, uint8_t bg) {
     if (col < 0 || col >= COLS || row < 0 || row >= ROWS) return;
     if (c < 32 || c > 127) c = ' ';
 
-    const uint8_t *glyph = font8x8[c - 32];
-    int px = col * 8;
-    int py = row * 8;
-
-    for (int y = 0; y < 8; y++) {
-        uint8_t bits = glyph[y];
-        for (int x = 0; x < 8; x++) {
-            uint8_t color = (bits & 0x80) ? fg : bg;
-            display_pset(px + x, py + y, color);
-            bits <<= 1;
-        }
-    }
+    BLIT(BLIT_SRC) = (uint32_t)font8x8[c - 32];
+    BLIT(BLIT_SRC_PITCH) = 1;
+    BLIT(BLIT_SRC_XY) = 0;
+    blit_start(BLIT_OP_EXPAND, col * 8, fb_line(row * 8), 8, 8, fg | (bg << 16));
 }
 
 void display_clear(void) {
     // Fill framebuffer with background color
-    // 640*400/2 = 128000 bytes
-    uint8_t fill = (bg_color << 4) | bg_color;
-    for (int i = 0; i < 128000; i++) {
-        fb[i] = fill;
-    }
+    scroll_row = 0;
+    *disp_scroll = 0;
+    fill_rect(0, 0, 640, 400, bg_color);
     cursor_x = 0;
     cursor_y = 0;
 }
 
-// Scroll screen up by one line
+// Scroll screen up by one line: clear the top line, which becomes the
+// bottom one once the display starts a line further down
 static void scroll(void) {
-    // Move lines 1-49 to 0-48
-    // Each line: 640 * 8 pixels / 2 = 2560 bytes
-    int line_bytes = 2560;
-    for (int i = 0; i < (ROWS - 1) * line_bytes; i++) {
-        fb[i] = fb[i + line_bytes];
-    }
-    // Clear last line
-    uint8_t fill = (bg_color << 4) | bg_color;
-    int last_line_start = (ROWS - 1) * line_bytes;
-    for (int i = 0; i < line_bytes; i++) {
-        fb[last_line_start + i] = fill;
-    }
+    fill_rect(0, 0, 640, 8, bg_color);
+    if (++scroll_row == ROWS) scroll_row = 0;
+    *disp_scroll = scroll_row * 8;
 }
 
 void display_putchar(int c) {
@@ -232,6 +280,26 @@ void display_putchar(int c) {
     }
 }
 
+// Show the page drawn so far from the next VBlank on and continue drawing
+// on the other one once it is off screen. Programs that redraw the whole
+// frame between flips never show a half-drawn frame.
+void display_flip(void) {
+    blit_wait();
+    if (draw_page != show_page) {
+        *disp_flip = draw_page;
+        while (*disp_status & DISP_STATUS_FLIP_PENDING);
+        show_page = draw_page;
+    }
+    draw_page = (show_page == FRAMEBUF_OFFSET) ? FRAMEBUF2_OFFSET : FRAMEBUF_OFFSET;
+    fb = (volatile uint8_t *)(FSMC_BASE + draw_page);
+}
+
+// Back to drawing on the displayed page
+void display_single_buffer(void) {
+    draw_page = show_page;
+    fb = (volatile uint8_t *)(FSMC_BASE + draw_page);
+}
+
 void display_set_color(uint8_t fg, uint8_t bg) {
     fg_color = fg & 0x0F;
     bg_color = bg & 0x0F;
@@ -0,0 +1,203 @@
+# Zba/Zbb/Zbs tests
+# With --bitmanip every instruction computes its result. Without it (as on
+# the CH32V307) every one of them raises an illegal instruction exception
+# and leaves its destination alone; the trap handler counts them and
+# resumes after the instruction.
+# Assembled with Zba/Zbb/Zbs enabled (see Makefile).
+
+.section .text
+.globl _start
+
+.equ MCAUSE_ILLEGAL, 2
+
+_start:
+    la      t0, trap_handler
+    csrw    mtvec, t0
+    li      s11, 0              # Illegal instruction traps taken
+
+    li      s0, 0x12345678
+    li      s1, 0x0000FF00
+    li      s2, -5
+    li      s3, 3
+    li      s4, 0x0000A5F0
+
+    # Probe: without Zbb this traps
+    andn    t1, s0, s1
+    bnez    s11, no_bitmanip
+
+    # ANDN / ORN / XNOR
+    li      t2, 0x12340078
+    bne     t1, t2, fail
+    orn     t1, s3, s1
+    li      t2, 0xFFFF00FF
+    bne     t1, t2, fail
+    xnor    t1, s0, s0
+    li      t2, -1
+    bne     t1, t2, fail
+
+    # SH1ADD / SH2ADD / SH3ADD
+    sh1add  t1, s3, s1
+    li      t2, 0xFF06
+    bne     t1, t2, fail
+    sh2add  t1, s3, s1
+    li      t2, 0xFF0C
+    bne     t1, t2, fail
+    sh3add  t1, s3, s1
+    li      t2, 0xFF18
+    bne     t1, t2, fail
+
+    # MIN / MINU / MAX / MAXU
+    min     t1, s2, s3
+    bne     t1, s2, fail
+    minu    t1, s2, s3
+    bne     t1, s3, fail
+    max     t1, s2, s3
+    bne     t1, s3, fail
+    maxu    t1, s2, s3
+    bne     t1, s2, fail
+
+    # ROL / ROR / RORI
+    rol     t1, s0, s3
+    li      t2, 0x91A2B3C0
+    bne     t1, t2, fail
+    ror     t1, s0, s3
+    li      t2, 0x02468ACF
+    bne     t1, t2, fail
+    rori    t1, s0, 8
+    li      t2, 0x78123456
+    bne     t1, t2, fail
+
+    # CLZ / CTZ / CPOP
+    clz     t1, s1
+    li      t2, 16
+    bne     t1, t2, fail
+    ctz     t1, s1
+    li      t2, 8
+    bne     t1, t2, fail
+    cpop    t1, s0
+    li      t2, 13
+    bne     t1, t2, fail
+    clz     t1, zero
+    li      t2, 32
+    bne     t1, t2, fail
+
+    # SEXT.B / SEXT.H / ZEXT.H
+    sext.b  t1, s4
+    li      t2, 0xFFFFFFF0
+    bne     t1, t2, fail
+    sext.h  t1, s4
+    li      t2, 0xFFFFA5F0
+    bne     t1, t2, fail
+    zext.h  t1, s2
+    li      t2, 0x0000FFFB
+    bne     t1, t2, fail
+
+    # ORC.B / REV8
+    orc.b   t1, s4
+    li      t2, 0x0000FFFF
+    bne     t1, t2, fail
+    rev8    t1, s0
+    li      t2, 0x78563412
+    bne     t1, t2, fail
+
+    # BCLR / BEXT / BINV / BSET and their immediate forms
+    bclr    t1, s0, s3
+    li      t2, 0x12345670
+    bne     t1, t2, fail
+    bclri   t1, s1, 8
+    li      t2, 0xFE00
+    bne     t1, t2, fail
+    bext    t1, s0, s3
+    li      t2, 1
+    bne     t1, t2, fail
+    bexti   t1, s0, 0
+    bnez    t1, fail
+    binv    t1, s0, s3
+    li      t2, 0x12345670
+    bne     t1, t2, fail
+    binvi   t1, s0, 31
+    li      t2, 0x92345678
+    bne     t1, t2, fail
+    bset    t1, s1, s3
+    li      t2, 0xFF08
+    bne     t1, t2, fail
+    bseti   t1, s1, 31
+    li      t2, 0x8000FF00
+    bne     t1, t2, fail
+
+    bnez    s11, fail
+    j       pass
+
+no_bitmanip:
+    # Every Zba/Zbb/Zbs instruction traps and leaves rd unchanged
+    li      s11, 0
+    li      t1, 0x5A5A5A5A
+    sh1add  t1, s3, s1
+    sh2add  t1, s3, s1
+    sh3add  t1, s3, s1
+    andn    t1, s0, s1
+    orn     t1, s3, s1
+    xnor    t1, s0, s0
+    min     t1, s2, s3
+    minu    t1, s2, s3
+    max     t1, s2, s3
+    maxu    t1, s2, s3
+    rol     t1, s0, s3
+    ror     t1, s0, s3
+    rori    t1, s0, 8
+    clz     t1, s1
+    ctz     t1, s1
+    cpop    t1, s0
+    sext.b  t1, s4
+    sext.h  t1, s4
+    zext.h  t1, s2
+    orc.b   t1, s4
+    rev8    t1, s0
+    bclr    t1, s0, s3
+    bclri   t1, s1, 8
+    bext    t1, s0, s3
+    bexti   t1, s0, 0
+    binv    t1, s0, s3
+    binvi   t1, s0, 31
+    bset    t1, s1, s3
+    bseti   t1, s1, 31
+    li      t2, 29
+    bne     s11, t2, fail
+    li      t2, 0x5A5A5A5A
+    bne     t1, t2, fail
+
+    # The base instructions sharing those opcodes still work
+    sub     t1, s3, s2
+    li      t2, 8
+    bne     t1, t2, fail
+    sra     t1, s2, s3
+    li      t2, -1
+    bne     t1, t2, fail
+    srai    t1, s1, 8
+    li      t2, 0xFF
+    bne     t1, t2, fail
+    slli    t1, s3, 4
+    li      t2, 0x30
+    bne     t1, t2, fail
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail:
+    li      gp, 1
+    li      a0, 1
+    ecall
+
+# Illegal instruction: count it and skip it (all of them are 32-bit)
+.align 4
+trap_handler:
+    csrr    t6, mcause
+    li      t5, MCAUSE_ILLEGAL
+    bne     t6, t5, fail
+    addi    s11, s11, 1
+    csrr    t6, mepc
+    addi    t6, t6, 4
+    csrw    mepc, t6
+    mret
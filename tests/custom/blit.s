@@ -0,0 +1,336 @@
+# 2D blitter test
+# Fill, overlapping copy and 1bpp expansion on FSMC surfaces; operations
+# complete after their cycle cost, with a completion interrupt.
+
+.section .text
+.globl _start
+
+.equ BLIT_CMD,      0x40019000
+.equ BLIT_STATUS,   0x40019004
+.equ BLIT_DST,      0x40019008
+.equ BLIT_DPITCH,   0x4001900C
+.equ BLIT_SRC,      0x40019010
+.equ BLIT_SPITCH,   0x40019014
+.equ BLIT_DXY,      0x40019018
+.equ BLIT_SXY,      0x4001901C
+.equ BLIT_SIZE,     0x40019020
+.equ BLIT_COLOR,    0x40019024
+
+.equ OP_FILL,       1
+.equ OP_COPY,       2
+.equ OP_EXPAND,     3
+.equ CMD_IE,        (1 << 4)
+.equ CMD_FMT16,     (1 << 5)
+.equ CMD_TRANSP,    (1 << 6)
+
+.equ ST_BUSY,       (1 << 0)
+.equ ST_DONE,       (1 << 1)
+.equ ST_ERR,        (1 << 2)
+
+.equ SURF,          0x60000000      # Scratch surfaces in FSMC, pitch 8
+
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPRR0,    0xE000E280
+.equ BLIT_IRQ,      27
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+
+.section .data
+.align 4
+irq_count:  .word 0
+
+.section .rodata
+glyph:      .byte 0xA5, 0xFF
+
+.section .text
+
+# Start the blit described by the registers with CMD = \cmd and wait
+.macro BLIT cmd
+    li      t0, BLIT_CMD
+    li      t1, \cmd
+    sw      t1, 0(t0)
+    call    wait_idle
+.endm
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
+    li      t0, BLIT_DPITCH
+    li      t1, 8
+    sw      t1, 0(t0)
+
+    # Test 1: 4bpp fill of x=1..5, y=1..2 with color 10. Nothing is
+    # written until BUSY clears, then DONE is set
+    li      t0, BLIT_DST
+    li      t1, SURF
+    sw      t1, 0(t0)
+    li      t0, BLIT_DXY
+    li      t1, 0x00010001
+    sw      t1, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00020005
+    sw      t1, 0(t0)
+    li      t0, BLIT_COLOR
+    li      t1, 10
+    sw      t1, 0(t0)
+    li      t0, BLIT_CMD
+    li      t1, OP_FILL
+    sw      t1, 0(t0)
+    li      t0, BLIT_STATUS
+    lw      t1, 0(t0)
+    andi    t1, t1, ST_BUSY
+    beqz    t1, fail1
+    li      t0, SURF
+    lw      t1, 8(t0)
+    bnez    t1, fail1
+    call    wait_idle
+    li      t0, BLIT_STATUS
+    lw      t1, 0(t0)
+    li      t2, ST_DONE
+    bne     t1, t2, fail1
+    sw      t2, 0(t0)               # Clear DONE
+    lw      t1, 0(t0)
+    bnez    t1, fail1
+    li      t0, SURF
+    lw      t1, 0(t0)               # Row 0 untouched
+    bnez    t1, fail1
+    li      t3, 0x00AAAAA0
+    lw      t1, 8(t0)
+    bne     t1, t3, fail1
+    lw      t1, 16(t0)
+    bne     t1, t3, fail1
+    lw      t1, 24(t0)              # Row 3 untouched
+    bnez    t1, fail1
+
+    # Test 2: expand 0xA5 to colors 1 (set) / 2 (clear), 4bpp
+    li      t0, BLIT_DST
+    li      t1, SURF + 0x100
+    sw      t1, 0(t0)
+    li      t0, BLIT_SRC
+    la      t1, glyph
+    sw      t1, 0(t0)
+    li      t0, BLIT_SPITCH
+    li      t1, 1
+    sw      t1, 0(t0)
+    li      t0, BLIT_DXY
+    sw      zero, 0(t0)
+    li      t0, BLIT_SXY
+    sw      zero, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00010008
+    sw      t1, 0(t0)
+    li      t0, BLIT_COLOR
+    li      t1, 0x00020001
+    sw      t1, 0(t0)
+    BLIT    OP_EXPAND
+    li      t0, SURF + 0x100
+    lw      t1, 0(t0)
+    li      t2, 0x12122121
+    bne     t1, t2, fail2
+
+    # Test 3: transparent expand of the next row (0xFF) at x=1, 3 pixels
+    # wide, in color 7: only set bits are drawn, 0 bits never occur
+    li      t0, BLIT_SXY
+    li      t1, 0x00010000
+    sw      t1, 0(t0)
+    li      t0, BLIT_DXY
+    li      t1, 1
+    sw      t1, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00010003
+    sw      t1, 0(t0)
+    li      t0, BLIT_COLOR
+    li      t1, 7
+    sw      t1, 0(t0)
+    BLIT    OP_EXPAND + CMD_TRANSP
+    li      t0, SURF + 0x100
+    lw      t1, 0(t0)
+    li      t2, 0x12127771
+    bne     t1, t2, fail3
+
+    # Test 4: 4bpp copy between even and odd nibble alignment: pixels
+    # 2..4 of that row (7 7 2) to x=0 of another surface
+    li      t0, BLIT_SRC
+    li      t1, SURF + 0x100
+    sw      t1, 0(t0)
+    li      t0, BLIT_SPITCH
+    li      t1, 8
+    sw      t1, 0(t0)
+    li      t0, BLIT_SXY
+    li      t1, 2
+    sw      t1, 0(t0)
+    li      t0, BLIT_DST
+    li      t1, SURF + 0x200
+    sw      t1, 0(t0)
+    li      t0, BLIT_DXY
+    sw      zero, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00010003
+    sw      t1, 0(t0)
+    BLIT    OP_COPY
+    li      t0, SURF + 0x200
+    lw      t1, 0(t0)
+    li      t2, 0x00000277          # Pixels 7 7 2
+    bne     t1, t2, fail4
+
+    # Test 5: overlapping RGB565 copy one pixel to the right
+    li      t0, SURF + 0x300
+    li      t1, 0x00020001
+    sw      t1, 0(t0)
+    li      t1, 0x00040003
+    sw      t1, 4(t0)
+    li      t0, BLIT_SRC
+    li      t1, SURF + 0x300
+    sw      t1, 0(t0)
+    li      t0, BLIT_DST
+    sw      t1, 0(t0)
+    li      t0, BLIT_SXY
+    sw      zero, 0(t0)
+    li      t0, BLIT_DXY
+    li      t1, 1
+    sw      t1, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00010004
+    sw      t1, 0(t0)
+    BLIT    OP_COPY + CMD_FMT16
+    li      t0, SURF + 0x300
+    lw      t1, 0(t0)
+    li      t2, 0x00010001
+    bne     t1, t2, fail5
+    lw      t1, 4(t0)
+    li      t2, 0x00030002
+    bne     t1, t2, fail5
+    lhu     t1, 8(t0)
+    li      t2, 4
+    bne     t1, t2, fail5
+
+    # Test 6: overlapping 4bpp copy one row down (rows go bottom-up)
+    li      t0, BLIT_SRC
+    li      t1, SURF
+    sw      t1, 0(t0)
+    li      t0, BLIT_DST
+    sw      t1, 0(t0)
+    li      t0, BLIT_SXY
+    li      t1, 0x00010000
+    sw      t1, 0(t0)
+    li      t0, BLIT_DXY
+    li      t1, 0x00020000
+    sw      t1, 0(t0)
+    li      t0, BLIT_SIZE
+    li      t1, 0x00020010
+    sw      t1, 0(t0)
+    BLIT    OP_COPY
+    li      t0, SURF
+    li      t3, 0x00AAAAA0
+    lw      t1, 16(t0)
+    bne     t1, t3, fail6
+    lw      t1, 24(t0)
+    bne     t1, t3, fail6
+
+    # Test 7: completion interrupt through the PFIC
+    li      t0, PFIC_IENR0
+    li      t1, (1 << BLIT_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    li      t0, BLIT_CMD
+    li      t1, OP_FILL + CMD_IE
+    sw      t1, 0(t0)
+    wfi
+    li      t0, MSTATUS_MIE
+    csrc    mstatus, t0
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail7
+
+    # Test 8: a surface outside host memory sets ERR
+    li      t0, BLIT_DST
+    li      t1, 0x50000000
+    sw      t1, 0(t0)
+    BLIT    OP_FILL
+    li      t0, BLIT_STATUS
+    lw      t1, 0(t0)
+    andi    t1, t1, ST_ERR
+    beqz    t1, fail8
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+fail5:
+    li      gp, 11
+    li      a0, 1
+    ecall
+
+fail6:
+    li      gp, 13
+    li      a0, 1
+    ecall
+
+fail7:
+    li      gp, 15
+    li      a0, 1
+    ecall
+
+fail8:
+    li      gp, 17
+    li      a0, 1
+    ecall
+
+# Spin until the blitter is idle
+wait_idle:
+    li      t0, BLIT_STATUS
+1:
+    lw      t1, 0(t0)
+    andi    t1, t1, ST_BUSY
+    bnez    t1, 1b
+    ret
+
+.align 4
+trap_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    csrr    t0, mcause
+    bgez    t0, 1f
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << BLIT_IRQ)
+    sw      t1, 0(t0)
+1:
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret
@@ -0,0 +1,285 @@
+# Counter CSR test
+# mcycle/minstret (and their high halves) are writable and keep counting
+# from the written value, the cycle/instret/hpmcounter CSRs shadow them,
+# mcountinhibit is hardwired to 0, mhpmevent3..6 select what
+# mhpmcounter3..6 count, and instret leaves out the cycles spent idling
+# in WFI and entering an interrupt.
+
+.section .text
+.globl _start
+
+.equ SYSTICK_CTRL,  0xE0000000
+.equ SYSTICK_SR,    0xE0000004
+.equ SYSTICK_CNT_L, 0xE0000008
+.equ SYSTICK_CMP_L, 0xE0000010
+.equ CTRL_ENABLE,   (1 << 0)
+.equ CTRL_TICKINT,  (1 << 1)
+
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPSR0,    0xE000E200
+.equ PFIC_IPRR0,    0xE000E280
+.equ SYSTICK_IRQ,   12
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+
+# mhpmevent values
+.equ EV_LOAD,       1
+.equ EV_STORE,      2
+.equ EV_BRANCH,     3           # Conditional branches taken
+.equ EV_MMIO,       4
+
+.equ SCRATCH,       0x20008000
+
+.section .data
+.align 4
+irq_count:  .word 0
+
+.section .text
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
+    # Test 1: mcycle counts on from a written value, mcycleh is writable
+    li      t0, 1000000
+    csrw    mcycle, t0
+    csrr    t1, mcycle
+    sub     t1, t1, t0
+    li      t2, 1               # The csrw itself took one cycle
+    bne     t1, t2, fail1
+    li      t0, 5
+    csrw    mcycleh, t0
+    csrr    t1, mcycleh
+    bne     t0, t1, fail1
+    csrw    mcycleh, zero
+
+    # Test 2: The same for minstret
+    li      t0, 2000000
+    csrw    minstret, t0
+    csrr    t1, minstret
+    sub     t1, t1, t0
+    li      t2, 1
+    bne     t1, t2, fail2
+    li      t0, 7
+    csrw    minstreth, t0
+    csrr    t1, minstreth
+    bne     t0, t1, fail2
+    csrw    minstreth, zero
+
+    # Test 3: The user-mode CSRs read the machine counters
+    csrr    t0, mcycle
+    csrr    t1, cycle
+    sub     t1, t1, t0
+    li      t2, 1
+    bne     t1, t2, fail3
+    csrr    t0, minstret
+    csrr    t1, instret
+    sub     t1, t1, t0
+    bne     t1, t2, fail3
+    li      t0, 9
+    csrw    mcycleh, t0
+    csrr    t1, cycleh
+    bne     t0, t1, fail3
+    csrw    mcycleh, zero
+
+    # Test 4: mcountinhibit reads 0 whatever is written, counters keep going
+    li      t0, 0x7D
+    csrw    mcountinhibit, t0
+    csrr    t1, mcountinhibit
+    bnez    t1, fail4
+    csrr    t0, mcycle
+    csrr    t1, mcycle
+    sub     t1, t1, t0
+    li      t2, 1
+    bne     t1, t2, fail4
+    csrr    t0, minstret
+    csrr    t1, minstret
+    sub     t1, t1, t0
+    bne     t1, t2, fail4
+
+    # Test 5: mhpmevent3..6 select loads, stores, taken branches and MMIO
+    # accesses; unknown events read back as 0 (none)
+    li      t0, EV_LOAD
+    csrw    mhpmevent3, t0
+    li      t0, EV_STORE
+    csrw    mhpmevent4, t0
+    li      t0, EV_BRANCH
+    csrw    mhpmevent5, t0
+    li      t0, EV_MMIO
+    csrw    mhpmevent6, t0
+    csrr    t1, mhpmevent6
+    bne     t0, t1, fail5
+    li      t0, 99
+    csrw    mhpmevent7, t0
+    csrr    t1, mhpmevent7
+    bnez    t1, fail5
+
+    csrw    mhpmcounter3, zero
+    csrw    mhpmcounter4, zero
+    csrw    mhpmcounter5, zero
+    csrw    mhpmcounter6, zero
+
+    li      t0, SCRATCH
+    sw      zero, 0(t0)         # 2 stores
+    sw      zero, 4(t0)
+    lw      t1, 0(t0)           # 3 loads from SRAM
+    lw      t1, 4(t0)
+    lw      t1, 8(t0)
+    li      t0, SYSTICK_CNT_L
+    lw      t1, 0(t0)           # 2 loads from a device
+    lw      t1, 0(t0)
+    li      t2, 5
+branch_loop:
+    addi    t2, t2, -1
+    bnez    t2, branch_loop     # Taken 4 times
+    beqz    t2, 1f              # Taken once more
+    nop
+1:
+    csrr    t3, mhpmcounter3
+    csrr    t4, mhpmcounter4
+    csrr    t5, mhpmcounter5
+    csrr    t6, mhpmcounter6
+    li      t0, 5
+    bne     t3, t0, fail5
+    li      t0, 2
+    bne     t4, t0, fail5
+    li      t0, 5
+    bne     t5, t0, fail5
+    li      t0, 2
+    bne     t6, t0, fail5
+    csrr    t0, hpmcounter4
+    bne     t0, t4, fail5
+
+    # Switching the event keeps the count, then counts the new event
+    csrw    mhpmevent4, zero
+    li      t0, SCRATCH
+    sw      zero, 0(t0)
+    csrr    t0, mhpmcounter4
+    bne     t0, t4, fail5
+
+    # Test 6: Interrupt entry takes a cycle but retires nothing. mcycle and
+    # minstret are read one instruction apart at both ends, so the span
+    # covers the same number of instructions
+    li      t0, PFIC_IENR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+
+    li      s2, PFIC_IPSR0
+    li      s3, (1 << SYSTICK_IRQ)
+    csrr    s0, mcycle
+    csrr    s1, minstret
+    sw      s3, 0(s2)           # Taken right after this store
+    csrr    s4, mcycle
+    csrr    s5, minstret
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail6
+    sub     s4, s4, s0
+    sub     s5, s5, s1
+    sub     t0, s4, s5
+    li      t2, 1               # The entry cycle
+    bne     t0, t2, fail6
+
+    # Test 7: WFI idle cycles count in mcycle only. SysTick fires a few
+    # hundred cycles after the core went to sleep
+    li      t0, SYSTICK_CNT_L
+    sw      zero, 0(t0)
+    li      t0, SYSTICK_CMP_L
+    li      t1, 400
+    sw      t1, 0(t0)
+    li      t0, SYSTICK_CTRL
+    li      t1, CTRL_ENABLE | CTRL_TICKINT
+    csrr    s0, mcycle
+    csrr    s1, minstret
+    sw      t1, 0(t0)
+    wfi
+    csrr    s4, mcycle
+    csrr    s5, minstret
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 2
+    bne     t1, t2, fail7
+    sub     s4, s4, s0
+    sub     s5, s5, s1
+    li      t0, 400
+    bltu    s4, t0, fail7       # Slept until the match
+    li      t0, 40
+    bgeu    s5, t0, fail7       # Only a handful of instructions retired
+    li      t0, MSTATUS_MIE
+    csrc    mstatus, t0
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+fail5:
+    li      gp, 11
+    li      a0, 1
+    ecall
+
+fail6:
+    li      gp, 13
+    li      a0, 1
+    ecall
+
+fail7:
+    li      gp, 15
+    li      a0, 1
+    ecall
+
+# SysTick interrupt: count it and clear the timer and the PFIC
+.align 4
+trap_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+
+    li      t0, SYSTICK_CTRL
+    sw      zero, 0(t0)
+    li      t0, SYSTICK_SR
+    li      t1, 1
+    sw      t1, 0(t0)
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret
@@ -7,6 +7,8 @@
 .equ DISPLAY_BASE,  0x40018000
 .equ DISPLAY_MODE,  0x40018000  # Mode register
 .equ DISPLAY_STATUS,0x40018004  # Status register
+.equ DISPLAY_SCROLL,0x40018008  # Vertical scroll (scanlines)
+.equ DISPLAY_FBBASE,0x4001800C  # Framebuffer offset in FSMC
 .equ DISPLAY_PAL,   0x40018040  # Palette base (16 x 16-bit)
 
 # Mode values
@@ -99,6 +101,35 @@ _start:
     lhu     t2, 2(t0)
     bnez    t2, fail8
 
+    # Test 9: Scroll register reads back, defaults to 0
+    li      t0, DISPLAY_SCROLL
+    lw      t1, 0(t0)
+    bnez    t1, fail9
+    li      t1, 24
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    bne     t1, t2, fail9
+    sw      zero, 0(t0)
+
+    # Test 10: Framebuffer base defaults to 0xE0000, is word aligned and
+    # clamped so the 128000-byte frame fits in the 1MB SRAM
+    li      t0, DISPLAY_FBBASE
+    lw      t1, 0(t0)
+    li      t3, 0xE0000
+    bne     t1, t3, fail10
+    li      t1, 0x40003
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    li      t3, 0x40000
+    bne     t2, t3, fail10
+    li      t1, 0xFFFFF
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    li      t3, 0xE0C00     # 0x100000 - 128000
+    bne     t2, t3, fail10
+    li      t1, 0xE0000
+    sw      t1, 0(t0)
+
     # All tests passed
 pass:
     li      gp, 1
@@ -144,3 +175,13 @@ fail8:
     li      gp, 17
     li      a0, 1
     ecall
+
+fail9:
+    li      gp, 19
+    li      a0, 1
+    ecall
+
+fail10:
+    li      gp, 21
+    li      a0, 1
+    ecall
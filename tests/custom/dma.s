@@ -14,28 +14,67 @@
 .equ DMA1_CH1_CPAR, 0x40020010  # Peripheral (source for M2M)
 .equ DMA1_CH1_CMAR, 0x40020014  # Memory (dest for M2M)
 
+# Channel 2 and 3 registers
+.equ DMA1_CH2_CCR,  0x4002001C
+.equ DMA1_CH2_CNDTR,0x40020020
+.equ DMA1_CH2_CPAR, 0x40020024
+.equ DMA1_CH2_CMAR, 0x40020028
+.equ DMA1_CH3_CCR,  0x40020030
+.equ DMA1_CH3_CNDTR,0x40020034
+.equ DMA1_CH3_CPAR, 0x40020038
+.equ DMA1_CH3_CMAR, 0x4002003C
+
 # CCR bits
 .equ CCR_EN,        (1 << 0)    # Enable
 .equ CCR_TCIE,      (1 << 1)    # Transfer complete IRQ enable
+.equ CCR_HTIE,      (1 << 2)    # Half transfer IRQ enable
 .equ CCR_DIR,       (1 << 4)    # Direction
 .equ CCR_PINC,      (1 << 6)    # Peripheral increment
 .equ CCR_MINC,      (1 << 7)    # Memory increment
 .equ CCR_PSIZE_W,   (2 << 8)    # Peripheral size = word
 .equ CCR_MSIZE_W,   (2 << 10)   # Memory size = word
+.equ CCR_PL_LOW,    (0 << 12)   # Priority level
+.equ CCR_PL_VHIGH,  (3 << 12)
 .equ CCR_MEM2MEM,   (1 << 14)   # Memory-to-memory mode
+.equ CCR_M2M_W,     CCR_EN | CCR_MEM2MEM | CCR_PINC | CCR_MINC | CCR_PSIZE_W | CCR_MSIZE_W
 
-# ISR bits for channel 1
+# ISR bits for channel 1 (4 bits per channel)
 .equ ISR_GIF1,      (1 << 0)
 .equ ISR_TCIF1,     (1 << 1)
+.equ ISR_HTIF1,     (1 << 2)
+.equ ISR_TCIF2,     (1 << 5)
+.equ ISR_TCIF3,     (1 << 9)
+.equ ISR_HTIF3,     (1 << 10)
+
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPRR0,    0xE000E280
+.equ DMA1_CH3_IRQ,  18
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+.equ MCAUSE_MEXT,   0x8000000B      # Machine external interrupt
 
 # RAM addresses
 .equ SRC_ADDR,      0x20008000
 .equ DST_ADDR,      0x20009000
+.equ BUF_A,         0x2000A000
+.equ BUF_B,         0x2000B000
+
+.section .data
+.align 4
+irq_count:  .word 0
+irq_cause:  .word 0
+irq_isr:    .word 0
+
+.section .text
 
 _start:
     # Initialize stack
     lui     sp, 0x20010
 
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
     # Test 1: Prepare source data in RAM
     li      t0, SRC_ADDR
     li      t1, 0xDEADBEEF
@@ -140,6 +179,180 @@ dma_done:
     and     t3, t1, t2
     bnez    t3, fail7
 
+    # Test 8: CCR.PL decides who gets the cycles. Channel 1 (low) starts
+    # first, channel 2 (very high) takes over as soon as it is enabled and
+    # finishes before channel 1 moves on
+    li      t0, DMA1_CH1_CPAR
+    li      t1, BUF_A
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH1_CMAR
+    li      t1, BUF_B
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH1_CNDTR
+    li      t1, 64
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH2_CPAR
+    li      t1, SRC_ADDR
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH2_CMAR
+    li      t1, DST_ADDR
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH2_CNDTR
+    li      t1, 64
+    sw      t1, 0(t0)
+
+    li      t0, DMA1_CH1_CCR
+    li      t1, CCR_M2M_W | CCR_PL_LOW
+    li      t2, DMA1_CH2_CCR
+    li      t3, CCR_M2M_W | CCR_PL_VHIGH
+    sw      t1, 0(t0)
+    sw      t3, 0(t2)
+
+    li      t0, DMA1_ISR
+    li      t3, 1000
+wait_ch2:
+    lw      t1, 0(t0)
+    andi    t2, t1, ISR_TCIF2
+    bnez    t2, ch2_done
+    addi    t3, t3, -1
+    bnez    t3, wait_ch2
+    j       fail8
+ch2_done:
+    andi    t2, t1, ISR_TCIF1
+    bnez    t2, fail8
+    li      t0, DMA1_CH1_CNDTR
+    lw      t1, 0(t0)
+    li      t2, 48              # At most a few elements before and after
+    blt     t1, t2, fail8
+
+    li      t0, DMA1_ISR
+    li      t3, 1000
+wait_ch1:
+    lw      t1, 0(t0)
+    andi    t2, t1, ISR_TCIF1
+    bnez    t2, ch1_done
+    addi    t3, t3, -1
+    bnez    t3, wait_ch1
+    j       fail8
+ch1_done:
+    li      t0, DMA1_IFCR
+    li      t1, 0xFFF
+    sw      t1, 0(t0)
+
+    # Test 9: HTIF is raised half way and HTIE turns it into a channel
+    # interrupt; without TCIE the completion stays silent. Neither address
+    # increments, so the count can be large enough that the second half
+    # cannot be done before the handler looks at ISR
+    li      t0, DMA1_CH3_CPAR
+    li      t1, BUF_A
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH3_CMAR
+    li      t1, BUF_B
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH3_CNDTR
+    li      t1, 8192
+    sw      t1, 0(t0)
+
+    li      t0, PFIC_IENR0
+    li      t1, (1 << DMA1_CH3_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+
+    li      t0, DMA1_CH3_CCR
+    li      t1, CCR_EN | CCR_MEM2MEM | CCR_PSIZE_W | CCR_MSIZE_W | CCR_HTIE
+    sw      t1, 0(t0)
+    wfi
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail9
+    la      t0, irq_cause
+    lw      t1, 0(t0)
+    li      t2, MCAUSE_MEXT
+    bne     t1, t2, fail9
+    la      t0, irq_isr
+    lw      t1, 0(t0)
+    li      t2, ISR_HTIF3
+    and     t3, t1, t2
+    beqz    t3, fail9
+    li      t2, ISR_TCIF3
+    and     t3, t1, t2
+    bnez    t3, fail9
+
+    li      t0, DMA1_ISR
+    li      t3, 10000
+wait_ch3:
+    lw      t1, 0(t0)
+    li      t2, ISR_TCIF3
+    and     t2, t1, t2
+    bnez    t2, ch3_done
+    addi    t3, t3, -1
+    bnez    t3, wait_ch3
+    j       fail9
+ch3_done:
+    li      t0, MSTATUS_MIE
+    csrc    mstatus, t0
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail9
+    li      t0, DMA1_IFCR
+    li      t1, 0xFFF
+    sw      t1, 0(t0)
+
+    # Test 10: A run that catches up past the half-transfer point in one
+    # go still raises HTIF and copies every element. 33 words, then stay
+    # away from the DMA well past both milestones
+    li      t0, SRC_ADDR
+    li      t1, 0xA5000000
+    li      t2, 33
+fill_src:
+    sw      t1, 0(t0)
+    addi    t0, t0, 4
+    addi    t1, t1, 1
+    addi    t2, t2, -1
+    bnez    t2, fill_src
+
+    li      t0, DMA1_CH1_CPAR
+    li      t1, SRC_ADDR
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH1_CMAR
+    li      t1, DST_ADDR
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH1_CNDTR
+    li      t1, 33
+    sw      t1, 0(t0)
+    li      t0, DMA1_CH1_CCR
+    li      t1, CCR_M2M_W
+    sw      t1, 0(t0)
+
+    li      t2, 100
+idle:
+    addi    t2, t2, -1
+    bnez    t2, idle
+
+    li      t0, DMA1_ISR
+    lw      t1, 0(t0)
+    andi    t2, t1, ISR_HTIF1
+    beqz    t2, fail10
+    andi    t2, t1, ISR_TCIF1
+    beqz    t2, fail10
+
+    li      t0, DST_ADDR
+    li      t1, 0xA5000000
+    li      t2, 33
+check_dst:
+    lw      t3, 0(t0)
+    bne     t3, t1, fail10
+    addi    t0, t0, 4
+    addi    t1, t1, 1
+    addi    t2, t2, -1
+    bnez    t2, check_dst
+
     # All tests passed
 pass:
     li      gp, 1
@@ -175,3 +388,49 @@ fail7:
     li      gp, 15
     li      a0, 1
     ecall
+
+fail8:
+    li      gp, 17
+    li      a0, 1
+    ecall
+
+fail9:
+    li      gp, 19
+    li      a0, 1
+    ecall
+
+fail10:
+    li      gp, 21
+    li      a0, 1
+    ecall
+
+# Channel 3 interrupt: record the cause and the ISR as seen on entry
+.align 4
+trap_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    li      t0, DMA1_ISR
+    lw      t1, 0(t0)
+    la      t0, irq_isr
+    sw      t1, 0(t0)
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+    csrr    t1, mcause
+    la      t0, irq_cause
+    sw      t1, 0(t0)
+
+    li      t0, DMA1_IFCR
+    li      t1, ISR_HTIF3
+    sw      t1, 0(t0)
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << DMA1_CH3_IRQ)
+    sw      t1, 0(t0)
+
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret
@@ -0,0 +1,167 @@
+# Display page flip and VBlank interrupt test
+# FLIP queues a new framebuffer base that the display takes over at the
+# next VBlank start, which also raises the VBlank IRQ when CTRL enables it.
+
+.section .text
+.globl _start
+
+.equ DISPLAY_STATUS,0x40018004
+.equ DISPLAY_FBBASE,0x4001800C
+.equ DISPLAY_CTRL,  0x40018010
+.equ DISPLAY_FLIP,  0x40018014
+
+.equ STATUS_VBLANK, (1 << 0)
+.equ STATUS_FLIP,   (1 << 1)        # FLIP pending
+.equ CTRL_VBLANK_IE,(1 << 0)
+
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPRR0,    0xE000E280
+.equ VBLANK_IRQ,    24
+
+.equ PAGE0,         0xE0000
+.equ PAGE1,         0xB0000
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+.equ MCAUSE_MEXT,   0x8000000B      # Machine external interrupt
+
+.section .data
+.align 4
+irq_count:  .word 0
+irq_cause:  .word 0
+irq_base:   .word 0
+
+.section .text
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
+    # Test 1: CTRL defaults to 0 and reads back
+    li      t0, DISPLAY_CTRL
+    lw      t1, 0(t0)
+    bnez    t1, fail1
+    li      t1, CTRL_VBLANK_IE
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    bne     t1, t2, fail1
+
+    # Test 2: FLIP is only queued: FBBASE is unchanged, STATUS shows it
+    # pending and FLIP reads back the queued base
+    li      t0, DISPLAY_FLIP
+    li      t1, PAGE1
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    bne     t1, t2, fail2
+    li      t0, DISPLAY_FBBASE
+    lw      t2, 0(t0)
+    li      t3, PAGE0
+    bne     t2, t3, fail2
+    li      t0, DISPLAY_STATUS
+    lw      t2, 0(t0)
+    andi    t2, t2, STATUS_FLIP
+    beqz    t2, fail2
+
+    # Test 3: VBlank IRQ through the PFIC; the flip is taken by then
+    li      t0, PFIC_IENR0
+    li      t1, (1 << VBLANK_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    wfi
+    csrc    mstatus, t0
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail3
+    la      t0, irq_cause
+    lw      t1, 0(t0)
+    li      t2, MCAUSE_MEXT
+    bne     t1, t2, fail3
+    la      t0, irq_base
+    lw      t1, 0(t0)
+    li      t2, PAGE1
+    bne     t1, t2, fail3
+    li      t0, DISPLAY_STATUS
+    lw      t1, 0(t0)
+    andi    t2, t1, STATUS_FLIP
+    bnez    t2, fail3
+    andi    t2, t1, STATUS_VBLANK
+    beqz    t2, fail3
+
+    # Test 4: With the IRQ off a flip is still taken at the next VBlank
+    li      t0, DISPLAY_CTRL
+    sw      zero, 0(t0)
+    li      t0, DISPLAY_FLIP
+    li      t1, PAGE0
+    sw      t1, 0(t0)
+    li      t0, DISPLAY_STATUS
+wait_flip:
+    lw      t1, 0(t0)
+    andi    t1, t1, STATUS_FLIP
+    bnez    t1, wait_flip
+    li      t0, DISPLAY_FBBASE
+    lw      t1, 0(t0)
+    li      t2, PAGE0
+    bne     t1, t2, fail4
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail4
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+.align 4
+trap_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+    csrr    t1, mcause
+    la      t0, irq_cause
+    sw      t1, 0(t0)
+    li      t0, DISPLAY_FBBASE
+    lw      t1, 0(t0)
+    la      t0, irq_base
+    sw      t1, 0(t0)
+
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << VBLANK_IRQ)
+    sw      t1, 0(t0)
+
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret
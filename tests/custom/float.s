@@ -0,0 +1,295 @@
+# RV32F single-precision floating point tests
+
+.section .text
+.globl _start
+
+_start:
+    la      a0, test_data
+
+    # Enable the FPU (mstatus.FS = Initial)
+    li      t0, 0x2000
+    csrs    mstatus, t0
+
+    # FMV.W.X / FMV.X.W round trip
+    li      t0, 0x3FC00000      # 1.5
+    fmv.w.x f1, t0
+    fmv.x.w t1, f1
+    bne     t0, t1, fail
+    li      t0, 0x40200000      # 2.5
+    fmv.w.x f2, t0
+
+    # FADD.S / FSUB.S / FMUL.S / FDIV.S
+    fadd.s  f3, f1, f2          # 4.0
+    fmv.x.w t1, f3
+    li      t2, 0x40800000
+    bne     t1, t2, fail
+    fsub.s  f3, f1, f2          # -1.0
+    fmv.x.w t1, f3
+    li      t2, 0xBF800000
+    bne     t1, t2, fail
+    fmul.s  f3, f1, f2          # 3.75
+    fmv.x.w t1, f3
+    li      t2, 0x40700000
+    bne     t1, t2, fail
+    fdiv.s  f3, f2, f1          # 2.5 / 1.5 = 1.6666666
+    fmv.x.w t1, f3
+    li      t2, 0x3FD55555
+    bne     t1, t2, fail
+
+    # FSQRT.S
+    li      t0, 0x41100000      # 9.0
+    fmv.w.x f4, t0
+    fsqrt.s f5, f4
+    fmv.x.w t1, f5
+    li      t2, 0x40400000      # 3.0
+    bne     t1, t2, fail
+
+    # FMADD.S / FMSUB.S / FNMSUB.S / FNMADD.S: 1.5 * 2.5 +- 9.0
+    fmadd.s f6, f1, f2, f4      # 12.75
+    fmv.x.w t1, f6
+    li      t2, 0x414C0000
+    bne     t1, t2, fail
+    fmsub.s f6, f1, f2, f4      # -5.25
+    fmv.x.w t1, f6
+    li      t2, 0xC0A80000
+    bne     t1, t2, fail
+    fnmsub.s f6, f1, f2, f4     # 5.25
+    fmv.x.w t1, f6
+    li      t2, 0x40A80000
+    bne     t1, t2, fail
+    fnmadd.s f6, f1, f2, f4     # -12.75
+    fmv.x.w t1, f6
+    li      t2, 0xC14C0000
+    bne     t1, t2, fail
+
+    # FSGNJ.S / FSGNJN.S / FSGNJX.S
+    fsgnj.s  f7, f1, f6         # -1.5
+    fmv.x.w t1, f7
+    li      t2, 0xBFC00000
+    bne     t1, t2, fail
+    fsgnjn.s f7, f7, f6         # 1.5
+    fmv.x.w t1, f7
+    li      t2, 0x3FC00000
+    bne     t1, t2, fail
+    fsgnjx.s f7, f6, f6         # 12.75
+    fmv.x.w t1, f7
+    li      t2, 0x414C0000
+    bne     t1, t2, fail
+
+    # FCVT.S.W / FCVT.S.WU
+    li      t0, -7
+    fcvt.s.w f8, t0
+    fmv.x.w t1, f8
+    li      t2, 0xC0E00000
+    bne     t1, t2, fail
+    li      t0, 0xFFFFFFFF
+    fcvt.s.wu f8, t0            # 4294967296.0 (rounded)
+    fmv.x.w t1, f8
+    li      t2, 0x4F800000
+    bne     t1, t2, fail
+
+    # FCVT.W.S with static rounding modes (2.5)
+    fcvt.w.s t1, f2, rne
+    li      t2, 2
+    bne     t1, t2, fail
+    fcvt.w.s t1, f2, rmm
+    li      t2, 3
+    bne     t1, t2, fail
+    fcvt.w.s t1, f2, rup
+    li      t2, 3
+    bne     t1, t2, fail
+    fsgnjn.s f9, f2, f2         # -2.5
+    fcvt.w.s t1, f9, rdn
+    li      t2, -3
+    bne     t1, t2, fail
+    fcvt.w.s t1, f9, rtz
+    li      t2, -2
+    bne     t1, t2, fail
+
+    # FCVT.W.S saturation sets NV
+    csrw    fflags, zero
+    li      t0, 0x7F800000      # +inf
+    fmv.w.x f10, t0
+    fcvt.w.s t1, f10, rtz
+    li      t2, 0x7FFFFFFF
+    bne     t1, t2, fail
+    fcvt.wu.s t1, f9, rtz       # -2.5 -> 0
+    bnez    t1, fail
+    csrr    t1, fflags
+    andi    t1, t1, 0x10
+    beqz    t1, fail
+
+    # FMIN.S / FMAX.S with NaN and signed zeros
+    li      t0, 0x7FC00000      # qNaN
+    fmv.w.x f11, t0
+    fmin.s  f12, f11, f1        # 1.5
+    fmv.x.w t1, f12
+    li      t2, 0x3FC00000
+    bne     t1, t2, fail
+    li      t0, 0x80000000      # -0.0
+    fmv.w.x f13, t0
+    fmv.w.x f14, zero           # +0.0
+    fmin.s  f12, f14, f13
+    fmv.x.w t1, f12
+    li      t2, 0x80000000
+    bne     t1, t2, fail
+    fmax.s  f12, f13, f14
+    fmv.x.w t1, f12
+    bnez    t1, fail
+
+    # FEQ.S / FLT.S / FLE.S
+    feq.s   t1, f13, f14        # -0 == +0
+    beqz    t1, fail
+    flt.s   t1, f1, f2
+    beqz    t1, fail
+    fle.s   t1, f2, f1
+    bnez    t1, fail
+    csrw    fflags, zero
+    feq.s   t1, f11, f11        # Quiet compare: no NV
+    bnez    t1, fail
+    csrr    t1, fflags
+    bnez    t1, fail
+    flt.s   t1, f11, f1         # Signaling compare: NV
+    bnez    t1, fail
+    csrr    t1, fflags
+    li      t2, 0x10
+    bne     t1, t2, fail
+
+    # FCLASS.S
+    fclass.s t1, f10            # +inf
+    li      t2, 0x80
+    bne     t1, t2, fail
+    fclass.s t1, f13            # -0
+    li      t2, 0x08
+    bne     t1, t2, fail
+    fclass.s t1, f11            # qNaN
+    li      t2, 0x200
+    bne     t1, t2, fail
+
+    # Exception flags and canonical NaN
+    csrw    fflags, zero
+    fdiv.s  f15, f1, f14        # 1.5 / 0 = +inf, DZ
+    csrr    t1, fflags
+    li      t2, 0x08
+    bne     t1, t2, fail
+    fdiv.s  f15, f14, f14       # 0 / 0 = canonical NaN, NV
+    fmv.x.w t1, f15
+    li      t2, 0x7FC00000
+    bne     t1, t2, fail
+    csrr    t1, fflags
+    li      t2, 0x18
+    bne     t1, t2, fail
+    li      t0, 0x40400000      # 3.0
+    fmv.w.x f16, t0
+    csrw    fflags, zero
+    fdiv.s  f17, f2, f16        # 2.5 / 3 inexact
+    csrr    t1, fflags
+    li      t2, 0x01
+    bne     t1, t2, fail
+
+    # Dynamic rounding mode from frm: 1 / 3 rounds down with RTZ
+    li      t0, 0x3F800000
+    fmv.w.x f18, t0
+    fdiv.s  f19, f18, f16       # RNE: 0x3EAAAAAB
+    fmv.x.w t1, f19
+    li      t2, 0x3EAAAAAB
+    bne     t1, t2, fail
+    fsrmi   1                   # frm = RTZ
+    fdiv.s  f19, f18, f16
+    fmv.x.w t1, f19
+    li      t2, 0x3EAAAAAA
+    bne     t1, t2, fail
+    frrm    t1
+    li      t2, 1
+    bne     t1, t2, fail
+    fsrmi   0
+    csrr    t1, fcsr
+    andi    t1, t1, 0xE0
+    bnez    t1, fail
+
+    # RMM: 1 + 2^-24 is a tie, RNE rounds to 1.0, RMM away from zero
+    li      t0, 0x33800000      # 2^-24
+    fmv.w.x f22, t0
+    fadd.s  f23, f18, f22
+    fmv.x.w t1, f23
+    li      t2, 0x3F800000
+    bne     t1, t2, fail
+    csrw    fflags, zero
+    fadd.s  f23, f18, f22, rmm
+    fmv.x.w t1, f23
+    li      t2, 0x3F800001
+    bne     t1, t2, fail
+    csrr    t1, fflags
+    li      t2, 0x01
+    bne     t1, t2, fail
+    fsgnjn.s f24, f18, f18      # -1.0
+    fsub.s  f23, f24, f22, rmm
+    fmv.x.w t1, f23
+    li      t2, 0xBF800001
+    bne     t1, t2, fail
+    fmadd.s f23, f18, f18, f22, rmm
+    fmv.x.w t1, f23
+    li      t2, 0x3F800001
+    bne     t1, t2, fail
+    fdiv.s  f19, f18, f16, rmm  # Not a tie: same as RNE
+    fmv.x.w t1, f19
+    li      t2, 0x3EAAAAAB
+    bne     t1, t2, fail
+    li      t0, 0x01000001      # 2^24 + 1
+    fcvt.s.w f23, t0, rmm
+    fmv.x.w t1, f23
+    li      t2, 0x4B800001
+    bne     t1, t2, fail
+    csrw    fflags, zero
+    fsrmi   4                   # frm = RMM
+    fadd.s  f23, f18, f22
+    fsrmi   0
+    fmv.x.w t1, f23
+    li      t2, 0x3F800001
+    bne     t1, t2, fail
+    csrw    fflags, zero
+    fadd.s  f23, f18, f18, rmm  # Exact: no flags
+    csrr    t1, fflags
+    bnez    t1, fail
+
+    # FLW / FSW
+    fsw     f6, 0(a0)
+    lw      t1, 0(a0)
+    li      t2, 0xC14C0000
+    bne     t1, t2, fail
+    li      t0, 0x3F000000      # 0.5
+    sw      t0, 4(a0)
+    flw     f20, 4(a0)
+    fmv.x.w t1, f20
+    bne     t0, t1, fail
+
+    # C.FLW / C.FSW / C.FLWSP / C.FSWSP
+    mv      s0, a0
+    c.fsw   f8, 8(s0)
+    c.flw   f9, 8(s0)
+    fmv.x.w t1, f9
+    li      t2, 0x4F800000
+    bne     t1, t2, fail
+    mv      t3, sp
+    mv      sp, a0
+    c.fswsp f1, 12(sp)
+    c.flwsp f21, 12(sp)
+    mv      sp, t3
+    fmv.x.w t1, f21
+    li      t2, 0x3FC00000
+    bne     t1, t2, fail
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail:
+    li      gp, 1
+    li      a0, 1
+    ecall
+
+.section .data
+.align 4
+test_data:
+    .word 0, 0, 0, 0
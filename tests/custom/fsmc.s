@@ -70,6 +70,29 @@ _start:
     li      t1, 0xDEADBEEF
     bne     t1, t2, fail7
 
+    # Test 8: Misaligned word spanning two pages
+    li      t0, FSMC_BASE + 0x2FFE
+    li      t1, 0x13579BDF
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    bne     t1, t2, fail8
+    lhu     t2, 0(t0)
+    li      t3, 0x9BDF
+    bne     t2, t3, fail8
+    lhu     t2, 2(t0)
+    li      t3, 0x1357
+    bne     t2, t3, fail8
+
+    # Test 9: Misaligned word running off the end of FSMC keeps the
+    # bytes that are inside it
+    li      t0, FSMC_BASE + FSMC_SIZE - 2
+    li      t1, 0x2468
+    sh      t1, 0(t0)
+    lw      t2, 0(t0)
+    slli    t2, t2, 16
+    srli    t2, t2, 16
+    bne     t1, t2, fail9
+
     # All tests passed
 pass:
     li      gp, 1
@@ -110,3 +133,13 @@ fail7:
     li      gp, 15
     li      a0, 1
     ecall
+
+fail8:
+    li      gp, 17
+    li      a0, 1
+    ecall
+
+fail9:
+    li      gp, 19
+    li      a0, 1
+    ecall
@@ -0,0 +1,170 @@
+# Hardware prologue/epilogue (HPE) test
+# With intsyscr.HWSTKEN set, interrupt entry saves ra, t0-t6 and a0-a7 and
+# MRET restores them, also across an exception taken inside the handler.
+
+.section .text
+.globl _start
+
+.equ PFIC_IENR0,    0xE000E100  # Interrupt enable set
+.equ PFIC_IPSR0,    0xE000E200  # Interrupt pending set
+.equ PFIC_IPRR0,    0xE000E280  # Interrupt pending clear
+
+.equ SYSTICK_IRQ,   12
+
+.equ INTSYSCR_HWSTKEN, 1
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+
+.section .data
+.align 4
+irq_count:
+    .word 0
+exc_count:
+    .word 0
+
+.section .text
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
+    # Test 1: Enable HPE
+    li      t0, INTSYSCR_HWSTKEN
+    csrw    0x804, t0           # intsyscr
+    csrr    t1, 0x804
+    bne     t0, t1, fail1
+
+    li      t0, PFIC_IENR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+
+    # Test 2: Caller-saved registers survive a handler that clobbers them
+    li      ra, 0x101
+    li      t0, 0x105
+    li      t1, 0x106
+    li      t2, 0x107
+    li      a0, 0x10A
+    li      a1, 0x10B
+    li      a5, 0x10F
+    li      a7, 0x111
+    li      t3, 0x11C
+    li      t6, 0x11F
+    li      s1, 0x109
+
+    li      s0, PFIC_IPSR0
+    li      s2, (1 << SYSTICK_IRQ)
+    sw      s2, 0(s0)
+    li      s2, MSTATUS_MIE
+    csrs    mstatus, s2
+    nop
+    nop
+    csrc    mstatus, s2
+
+    la      s0, irq_count
+    lw      s2, 0(s0)
+    li      s3, 1
+    bne     s2, s3, fail2
+    la      s0, exc_count
+    lw      s2, 0(s0)
+    bne     s2, s3, fail2
+
+    li      s2, 0x101
+    bne     ra, s2, fail3
+    li      s2, 0x105
+    bne     t0, s2, fail3
+    li      s2, 0x106
+    bne     t1, s2, fail3
+    li      s2, 0x107
+    bne     t2, s2, fail3
+    li      s2, 0x10A
+    bne     a0, s2, fail3
+    li      s2, 0x10B
+    bne     a1, s2, fail3
+    li      s2, 0x10F
+    bne     a5, s2, fail3
+    li      s2, 0x111
+    bne     a7, s2, fail3
+    li      s2, 0x11C
+    bne     t3, s2, fail3
+    li      s2, 0x11F
+    bne     t6, s2, fail3
+
+    # Test 4: Callee-saved registers are not stacked
+    li      s2, 0xBAD
+    bne     s1, s2, fail4
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+# Trap handler: no software register saves
+.align 4
+trap_handler:
+    csrr    t0, mcause
+    bltz    t0, handle_interrupt
+
+    # Exception (the illegal instruction below): skip it and clobber
+    # registers again. Its MRET must not pop the interrupt's frame.
+    la      t0, exc_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+    csrr    t0, mepc
+    addi    t0, t0, 4
+    csrw    mepc, t0
+    li      a0, -2
+    li      t0, -2
+    mret
+
+handle_interrupt:
+    la      t0, irq_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+
+    # Nested exception; keep mepc in a callee-saved register
+    csrr    s0, mepc
+    .word   0x00000000
+    csrw    mepc, s0
+
+    li      ra, -1
+    li      t1, -1
+    li      t2, -1
+    li      a0, -1
+    li      a1, -1
+    li      a5, -1
+    li      a7, -1
+    li      t3, -1
+    li      t6, -1
+    li      s1, 0xBAD
+    mret
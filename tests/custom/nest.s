@@ -0,0 +1,251 @@
+# Nested interrupt test
+# With intsyscr.INESTEN set, a higher-priority IRQ preempts a running
+# handler unless it cleared mstatus.MIE; one of equal priority waits until
+# it returns. IACTR tracks the handlers in progress.
+
+.section .text
+.globl _start
+
+.equ PFIC_VTFIDR,   0xE000E060
+.equ PFIC_VTFADDR0, 0xE000E080
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPSR0,    0xE000E200
+.equ PFIC_IPRR0,    0xE000E280
+.equ PFIC_IACTR0,   0xE000E300
+.equ PFIC_IPRIOR1,  0xE000E404  # IRQs 8-15
+
+.equ IRQ_A,         12          # Priority 1
+.equ IRQ_B,         13          # Priority 1
+.equ IRQ_C,         14          # Priority 0 (highest)
+.equ IRQ_D,         15          # Priority 1, masks with MIE
+
+.equ INTSYSCR_HWSTKEN, 1
+.equ INTSYSCR_INESTEN, 2
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+
+# Append \val to the log (uses t0-t2)
+.macro LOG val
+    la      t0, log_ptr
+    lw      t1, 0(t0)
+    li      t2, \val
+    sw      t2, 0(t1)
+    addi    t1, t1, 4
+    sw      t1, 0(t0)
+.endm
+
+.section .data
+.align 4
+log_ptr:
+    .word 0
+log:
+    .space 64
+
+.section .text
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, log
+    la      t1, log_ptr
+    sw      t0, 0(t1)
+
+    la      t0, fail_handler
+    csrw    mtvec, t0
+
+    # HPE saves the handlers' scratch registers, nesting on
+    li      t0, INTSYSCR_HWSTKEN | INTSYSCR_INESTEN
+    csrw    0x804, t0
+    csrr    t1, 0x804
+    bne     t0, t1, fail1
+
+    # Priorities
+    li      t0, PFIC_IPRIOR1
+    li      t1, (1 << ((IRQ_A - 8) * 4)) | (1 << ((IRQ_B - 8) * 4)) | (1 << ((IRQ_D - 8) * 4))
+    sw      t1, 0(t0)
+
+    # Each IRQ has its own VTF handler
+    li      t0, PFIC_VTFIDR
+    li      t1, IRQ_A | (IRQ_B << 8) | (IRQ_C << 16) | (IRQ_D << 24)
+    sw      t1, 0(t0)
+    li      t0, PFIC_VTFADDR0
+    la      t1, handler_a
+    ori     t1, t1, 1
+    sw      t1, 0(t0)
+    la      t1, handler_b
+    ori     t1, t1, 1
+    sw      t1, 4(t0)
+    la      t1, handler_c
+    ori     t1, t1, 1
+    sw      t1, 8(t0)
+    la      t1, handler_d
+    ori     t1, t1, 1
+    sw      t1, 12(t0)
+
+    li      t0, PFIC_IENR0
+    li      t1, (1 << IRQ_A) | (1 << IRQ_B) | (1 << IRQ_C) | (1 << IRQ_D)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+
+    # Test 2: A runs, C preempts it, B waits for A
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << IRQ_A)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    nop
+    nop
+    nop
+    nop
+    csrc    mstatus, t0
+
+    la      s0, log
+    lw      t0, 0(s0)
+    li      t1, IRQ_A
+    bne     t0, t1, fail2
+    lw      t0, 4(s0)
+    li      t1, IRQ_C
+    bne     t0, t1, fail2
+    lw      t0, 8(s0)
+    li      t1, (1 << IRQ_A) | (1 << IRQ_C)
+    bne     t0, t1, fail3
+    lw      t0, 12(s0)
+    li      t1, 0x100 + IRQ_C
+    bne     t0, t1, fail2
+    lw      t0, 16(s0)
+    li      t1, 0x100 + IRQ_A
+    bne     t0, t1, fail2
+    lw      t0, 20(s0)
+    li      t1, IRQ_B
+    bne     t0, t1, fail2
+
+    # Test 4: Nothing left active
+    li      t0, PFIC_IACTR0
+    lw      t1, 0(t0)
+    bnez    t1, fail4
+
+    # Test 5: D clears MIE, so C waits for it to return
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << IRQ_D)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    nop
+    nop
+    nop
+    nop
+    csrc    mstatus, t0
+
+    lw      t0, 24(s0)
+    li      t1, IRQ_D
+    bne     t0, t1, fail5
+    lw      t0, 28(s0)
+    li      t1, 0x100 + IRQ_D
+    bne     t0, t1, fail5
+    lw      t0, 32(s0)
+    li      t1, IRQ_C
+    bne     t0, t1, fail5
+    lw      t0, 36(s0)
+    li      t1, (1 << IRQ_C)
+    bne     t0, t1, fail5
+    lw      t0, 44(s0)
+    bnez    t0, fail5
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+fail5:
+    li      gp, 11
+    li      a0, 1
+    ecall
+
+.align 4
+fail_handler:
+    li      gp, 13
+    li      a0, 1
+    ecall
+
+# IRQ A: raises C (preempts at once) and B (must wait)
+.align 4
+handler_a:
+    LOG     IRQ_A
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << IRQ_A)
+    sw      t1, 0(t0)
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << IRQ_C)
+    sw      t1, 0(t0)
+    nop
+    li      t1, (1 << IRQ_B)
+    sw      t1, 0(t0)
+    nop
+    nop
+    LOG     0x100+IRQ_A
+    mret
+
+# IRQ B
+.align 4
+handler_b:
+    LOG     IRQ_B
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << IRQ_B)
+    sw      t1, 0(t0)
+    mret
+
+# IRQ D: masks preemption, then raises C
+.align 4
+handler_d:
+    LOG     IRQ_D
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << IRQ_D)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrc    mstatus, t0
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << IRQ_C)
+    sw      t1, 0(t0)
+    nop
+    nop
+    LOG     0x100+IRQ_D
+    mret
+
+# IRQ C: logs the active IRQs
+.align 4
+handler_c:
+    LOG     IRQ_C
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << IRQ_C)
+    sw      t1, 0(t0)
+    li      t0, PFIC_IACTR0
+    lw      t3, 0(t0)
+    la      t0, log_ptr
+    lw      t1, 0(t0)
+    sw      t3, 0(t1)
+    addi    t1, t1, 4
+    sw      t1, 0(t0)
+    LOG     0x100+IRQ_C
+    mret
@@ -76,6 +76,96 @@ wait_loop:
     and     t3, t2, t1
     bnez    t3, fail6           # Should be cleared now
 
+    # Test 7: CNT counts CPU cycles: between two reads it advances by
+    # exactly as much as mcycle does
+    li      t0, SYSTICK_CMP_L
+    sw      zero, 0(t0)         # No compare match
+    li      t0, SYSTICK_CTRL
+    li      t1, CTRL_ENABLE
+    sw      t1, 0(t0)
+    li      t0, SYSTICK_CNT_L
+    csrr    a1, mcycle
+    lw      t1, 0(t0)
+    li      t3, 20
+count_loop:
+    addi    t3, t3, -1
+    bnez    t3, count_loop
+    csrr    a2, mcycle
+    lw      t2, 0(t0)
+    sub     t2, t2, t1
+    sub     a2, a2, a1
+    beqz    t2, fail7
+    bne     t2, a2, fail7
+
+    # Test 8: Periodic mode reloads the compare value from RELOAD at the
+    # match, restarts the count and stays enabled
+    li      t0, SYSTICK_CTRL
+    sw      zero, 0(t0)
+    li      t0, SYSTICK_CNT_L
+    sw      zero, 0(t0)
+    li      t0, SYSTICK_CMP_L
+    li      t1, 50
+    sw      t1, 0(t0)
+    li      t0, SYSTICK_RELOAD
+    li      t1, 300
+    sw      t1, 0(t0)
+    li      t0, SYSTICK_CTRL
+    li      t1, CTRL_ENABLE | CTRL_MODE
+    sw      t1, 0(t0)
+
+    li      t0, SYSTICK_SR
+    li      t3, 1000
+wait_match:
+    lw      t1, 0(t0)
+    andi    t1, t1, SR_CNTIF
+    bnez    t1, matched
+    addi    t3, t3, -1
+    bnez    t3, wait_match
+    j       fail8
+matched:
+    li      t0, SYSTICK_CNT_L
+    lw      t1, 0(t0)
+    li      t2, 50              # Well below the 300 it would need if not
+    bgeu    t1, t2, fail8       # restarted
+    li      t0, SYSTICK_CMP_L
+    lw      t1, 0(t0)
+    li      t2, 300
+    bne     t1, t2, fail8
+    li      t0, SYSTICK_CTRL
+    lw      t1, 0(t0)
+    andi    t1, t1, CTRL_ENABLE
+    beqz    t1, fail8
+
+    # The next match comes RELOAD cycles later
+    li      t0, SYSTICK_SR
+    li      t1, SR_CNTIF
+    sw      t1, 0(t0)
+    li      t3, 1000
+wait_match2:
+    lw      t1, 0(t0)
+    andi    t1, t1, SR_CNTIF
+    bnez    t1, matched2
+    addi    t3, t3, -1
+    bnez    t3, wait_match2
+    j       fail8
+matched2:
+    li      t0, SYSTICK_CNT_L
+    lw      t1, 0(t0)
+    li      t2, 50
+    bgeu    t1, t2, fail8
+
+    # Test 9: Disabling freezes CNT at its current value
+    li      t0, SYSTICK_CTRL
+    sw      zero, 0(t0)
+    li      t0, SYSTICK_CNT_L
+    lw      t1, 0(t0)
+    li      t3, 50
+freeze_loop:
+    addi    t3, t3, -1
+    bnez    t3, freeze_loop
+    lw      t2, 0(t0)
+    bne     t1, t2, fail9
+
     # All tests passed
 pass:
     li      gp, 1
@@ -106,3 +196,18 @@ fail6:
     li      gp, 13
     li      a0, 1
     ecall
+
+fail7:
+    li      gp, 15
+    li      a0, 1
+    ecall
+
+fail8:
+    li      gp, 17
+    li      a0, 1
+    ecall
+
+fail9:
+    li      gp, 19
+    li      a0, 1
+    ecall
@@ -0,0 +1,174 @@
+# PFIC vector-table-free (VTF) interrupt test
+# An IRQ named in VTFIDR with an enabled VTFADDR jumps straight to that
+# address; other IRQs still go through mtvec.
+
+.section .text
+.globl _start
+
+.equ PFIC_VTFIDR,   0xE000E060
+.equ PFIC_VTFADDR0, 0xE000E080
+.equ PFIC_IENR0,    0xE000E100
+.equ PFIC_IPSR0,    0xE000E200
+.equ PFIC_IPRR0,    0xE000E280
+
+.equ SYSTICK_IRQ,   12
+.equ SW_IRQ,        14
+
+.equ MSTATUS_MIE,   (1 << 3)
+.equ MIE_MEIE,      (1 << 11)
+
+.section .data
+.align 4
+vtf_count:
+    .word 0
+trap_count:
+    .word 0
+
+.section .text
+
+_start:
+    lui     sp, 0x20010
+
+    la      t0, trap_handler
+    csrw    mtvec, t0
+
+    # Test 1: VTF slot 1 = SysTick IRQ at vtf_handler
+    li      t0, PFIC_VTFIDR
+    li      t1, (SYSTICK_IRQ << 8)
+    sw      t1, 0(t0)
+    lw      t2, 0(t0)
+    bne     t1, t2, fail1
+    li      t0, PFIC_VTFADDR0
+    la      t1, vtf_handler
+    ori     t1, t1, 1           # Enable
+    sw      t1, 4(t0)
+    lw      t2, 4(t0)
+    bne     t1, t2, fail1
+
+    li      t0, PFIC_IENR0
+    li      t1, (1 << SYSTICK_IRQ) | (1 << SW_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MIE_MEIE
+    csrs    mie, t0
+
+    # Test 2: SysTick IRQ goes to vtf_handler
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    nop
+    nop
+    csrc    mstatus, t0
+
+    la      t0, vtf_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail2
+    la      t0, trap_count
+    lw      t1, 0(t0)
+    bnez    t1, fail2
+
+    # Test 3: Another IRQ still goes through mtvec
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << SW_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    nop
+    nop
+    csrc    mstatus, t0
+
+    la      t0, trap_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail3
+
+    # Test 4: Disabled VTF slot falls back to mtvec
+    li      t0, PFIC_VTFADDR0
+    la      t1, vtf_handler
+    sw      t1, 4(t0)           # Enable bit clear
+    li      t0, PFIC_IPSR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+    li      t0, MSTATUS_MIE
+    csrs    mstatus, t0
+    nop
+    nop
+    csrc    mstatus, t0
+
+    la      t0, trap_count
+    lw      t1, 0(t0)
+    li      t2, 2
+    bne     t1, t2, fail4
+    la      t0, vtf_count
+    lw      t1, 0(t0)
+    li      t2, 1
+    bne     t1, t2, fail4
+
+pass:
+    li      gp, 1
+    li      a0, 0
+    ecall
+
+fail1:
+    li      gp, 3
+    li      a0, 1
+    ecall
+
+fail2:
+    li      gp, 5
+    li      a0, 1
+    ecall
+
+fail3:
+    li      gp, 7
+    li      a0, 1
+    ecall
+
+fail4:
+    li      gp, 9
+    li      a0, 1
+    ecall
+
+# VTF handler: SysTick IRQ only
+.align 4
+vtf_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    la      t0, vtf_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << SYSTICK_IRQ)
+    sw      t1, 0(t0)
+
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret
+
+# mtvec handler: clears any pending test IRQ
+.align 4
+trap_handler:
+    addi    sp, sp, -8
+    sw      t0, 0(sp)
+    sw      t1, 4(sp)
+
+    la      t0, trap_count
+    lw      t1, 0(t0)
+    addi    t1, t1, 1
+    sw      t1, 0(t0)
+
+    li      t0, PFIC_IPRR0
+    li      t1, (1 << SYSTICK_IRQ) | (1 << SW_IRQ)
+    sw      t1, 0(t0)
+
+    lw      t0, 0(sp)
+    lw      t1, 4(sp)
+    addi    sp, sp, 8
+    mret